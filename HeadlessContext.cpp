@@ -0,0 +1,152 @@
+#include "HeadlessContext.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height)
+	: m_width(width), m_height(height)
+{
+#ifdef __linux__
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+		(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	EGLDisplay display = getPlatformDisplay
+		? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+		: EGL_NO_DISPLAY;
+	EGLint major, minor;
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+	{
+		std::cerr << "[ERROR]Failed to initialize a surfaceless EGL display\n";
+		return;
+	}
+	m_display = display;
+
+	// no surface at all, the config only has to support desktop GL
+	EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLConfig config = NULL;
+	EGLint configs = 0;
+	eglChooseConfig(display, configAttributes, &config, 1, &configs);
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "[ERROR]EGL has no desktop OpenGL\n";
+		return;
+	}
+
+	// same version and profile the windowed path asks GLFW for
+	EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext context = eglCreateContext(display, configs ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+	{
+		std::cerr << "[ERROR]Failed to create a surfaceless GL 3.3 core context\n";
+		return;
+	}
+	m_context = context;
+
+	if (!gladLoadGLLoader(loader()))
+	{
+		std::cerr << "[ERROR]Failed to initialized GLAD\n";
+		return;
+	}
+
+	// there is no default framebuffer, everything goes here
+	glGenRenderbuffers(1, &m_color);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthStencil);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthStencil);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_color);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_depthStencil);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "[ERROR]Offscreen framebuffer is incomplete\n";
+		return;
+	}
+	bind();
+	m_valid = true;
+#else
+	std::cerr << "[ERROR]Headless mode needs EGL, which is only set up on Linux\n";
+#endif
+}
+
+HeadlessContext::~HeadlessContext()
+{
+#ifdef __linux__
+	if (m_context)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_color);
+		glDeleteRenderbuffers(1, &m_depthStencil);
+		eglMakeCurrent((EGLDisplay)m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)m_display, (EGLContext)m_context);
+	}
+	if (m_display)
+		eglTerminate((EGLDisplay)m_display);
+#endif
+}
+
+GLADloadproc HeadlessContext::loader()
+{
+#ifdef __linux__
+	return (GLADloadproc)eglGetProcAddress;
+#else
+	return nullptr;
+#endif
+}
+
+void HeadlessContext::bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, m_width, m_height);
+}
+
+bool HeadlessContext::writePPM(const std::string& path) const
+{
+	std::vector<unsigned char> pixels((size_t)m_width * m_height * 3);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_width, m_height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "[ERROR]Failed to open " << path << " for writing\n";
+		return false;
+	}
+	file << "P6\n" << m_width << " " << m_height << "\n255\n";
+	// GL rows start at the bottom, PPM rows at the top
+	for (int row = m_height - 1; row >= 0; row--)
+		file.write((const char*)&pixels[(size_t)row * m_width * 3], (std::streamsize)m_width * 3);
+	return (bool)file;
+}
+
+HeadlessContext::Percentiles HeadlessContext::percentiles(std::vector<double> times)
+{
+	Percentiles result;
+	if (times.empty())
+		return result;
+	std::sort(times.begin(), times.end());
+	auto rank = [&](double p)
+	{
+		size_t index = (size_t)std::ceil(p * times.size());
+		return times[std::min(times.size(), std::max<size_t>(index, 1)) - 1];
+	};
+	result.p50 = rank(.50);
+	result.p95 = rank(.95);
+	result.p99 = rank(.99);
+	return result;
+}
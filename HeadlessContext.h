@@ -0,0 +1,73 @@
+#pragma once
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+
+// Core cpp lib
+#include <string>
+#include <vector>
+
+/*! @brief GL context without a display, rendering into an FBO.
+ *
+ *	Uses EGL with the surfaceless platform (EGL_MESA_platform_surfaceless),
+ *	so it runs on render nodes and CI boxes with no X or Wayland, software
+ *	rasterizer included (LIBGL_ALWAYS_SOFTWARE=1 forces llvmpipe). Link
+ *	with -lEGL. EGL is only wired up on Linux; elsewhere valid() is
+ *	always false.
+ *
+ *	The context is current and glad is loaded once the constructor
+ *	returns. All rendering goes into an RGBA8 + depth24/stencil8
+ *	framebuffer object that stays bound, so code written for the default
+ *	framebuffer works unchanged.
+ */
+class HeadlessContext
+{
+public:
+	HeadlessContext(int, int);
+	~HeadlessContext();
+
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+	// False if no context could be created, the reason is printed
+	bool valid() const { return m_valid; }
+
+	// Loader to pass on to loadGLExtensions
+	static GLADloadproc loader();
+
+	// Bind the offscreen framebuffer and its viewport
+	void bind() const;
+
+	GLuint framebuffer() const { return m_framebuffer; }
+	int width() const { return m_width; }
+	int height() const { return m_height; }
+
+	// Read the framebuffer back and write it as a binary PPM
+	bool writePPM(const std::string&) const;
+
+	struct Percentiles
+	{
+		double p50 = 0.0;
+		double p95 = 0.0;
+		double p99 = 0.0;
+	};
+
+	// Nearest rank percentiles of the frame times
+	static Percentiles percentiles(std::vector<double>);
+
+private:
+	int    m_width;
+	int    m_height;
+	bool   m_valid = false;
+	GLuint m_framebuffer  = 0;
+	GLuint m_color        = 0;
+	GLuint m_depthStencil = 0;
+
+	// EGLDisplay / EGLContext, kept opaque so EGL stays out of this header
+	void*  m_display = nullptr;
+	void*  m_context = nullptr;
+};
+
+#endif // !HEADLESS_CONTEXT_H
@@ -0,0 +1,289 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+namespace
+{
+	const size_t NO_EVENT = (size_t)-1;
+
+	std::string escape(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				escaped += '\\';
+			escaped += c;
+		}
+		return escaped;
+	}
+}
+
+Profiler::Scope::Scope(Profiler& profiler, const char* name, bool gpu)
+	: m_profiler(profiler), m_event(profiler.begin(name, gpu))
+{
+}
+
+Profiler::Scope::~Scope()
+{
+	m_profiler.end(m_event);
+}
+
+Profiler::Profiler(size_t window, size_t traceFrames)
+	: m_start(Clock::now()), m_window(std::max<size_t>(window, 1)), m_traceFrames(traceFrames)
+{
+	// a 0 bit counter means no timestamps on this implementation
+	GLint bits = 0;
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+	m_gpu = bits > 0;
+
+	// line the GPU clock up with ours once, the trace shows both on one time axis
+	if (m_gpu)
+	{
+		GLint64 gpuNow = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+		m_gpuOffset = (double)gpuNow / 1e6 - now();
+	}
+}
+
+Profiler::~Profiler()
+{
+	for (Frame& frame : m_frames)
+		if (!frame.queries.empty())
+			glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+}
+
+void Profiler::beginFrame()
+{
+	// the pool was last used FRAMES_IN_FLIGHT frames ago, its results should be in by now
+	Frame& frame = m_frames[m_frame % FRAMES_IN_FLIGHT];
+	if (frame.active)
+		resolve(frame);
+
+	frame.active = true;
+	frame.events.clear();
+	frame.usedQueries = 0;
+
+	m_current    = &frame;
+	m_depth      = 0;
+	m_frameEvent = begin("frame", true);
+}
+
+void Profiler::endFrame()
+{
+	end(m_frameEvent);
+	m_current = nullptr;
+	m_frame++;
+}
+
+void Profiler::flush()
+{
+	// oldest first, the trace stays in frame order
+	for (uint64_t frame = m_frame; frame < m_frame + FRAMES_IN_FLIGHT; frame++)
+	{
+		Frame& pool = m_frames[frame % FRAMES_IN_FLIGHT];
+		if (pool.active && &pool != m_current)
+			resolve(pool, true);
+	}
+}
+
+size_t Profiler::begin(const char* name, bool gpu)
+{
+	// zones outside beginFrame/endFrame aren't recorded
+	if (!m_current)
+		return NO_EVENT;
+
+	auto zone = m_zones.find(name);
+	if (zone == m_zones.end())
+	{
+		zone = m_zones.emplace(name, (uint32_t)m_names.size()).first;
+		m_names.push_back(name);
+		m_depths.push_back(0);
+	}
+
+	Event event;
+	event.zone     = zone->second;
+	event.depth    = m_depth++;
+	event.cpuBegin = now();
+	event.cpuEnd   = event.cpuBegin;
+	if (gpu && m_gpu)
+	{
+		Frame& frame = *m_current;
+		if (frame.usedQueries + 2 > frame.queries.size())
+		{
+			size_t count = frame.queries.size();
+			frame.queries.resize(count + 2);
+			glGenQueries(2, &frame.queries[count]);
+		}
+		event.query = (GLint)frame.usedQueries;
+		frame.usedQueries += 2;
+		glQueryCounter(frame.queries[event.query], GL_TIMESTAMP);
+	}
+	m_current->events.push_back(event);
+	return m_current->events.size() - 1;
+}
+
+void Profiler::end(size_t index)
+{
+	if (index == NO_EVENT || !m_current)
+		return;
+
+	Event& event = m_current->events[index];
+	if (event.query >= 0)
+		glQueryCounter(m_current->queries[event.query + 1], GL_TIMESTAMP);
+	event.cpuEnd = now();
+	m_depth--;
+}
+
+double Profiler::now() const
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - m_start).count();
+}
+
+void Profiler::resolve(Frame& frame, bool wait)
+{
+	frame.active = false;
+
+	// queries complete in order, if the last one is in they all are. GL_QUERY_RESULT below waits for them
+	if (frame.usedQueries)
+	{
+		GLint available = wait ? GL_TRUE : GL_FALSE;
+		if (!wait)
+			glGetQueryObjectiv(frame.queries[frame.usedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			m_dropped++;
+		else
+		{
+			for (Event& event : frame.events)
+			{
+				if (event.query < 0)
+					continue;
+				GLuint64 begin = 0, end = 0;
+				glGetQueryObjectui64v(frame.queries[event.query], GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(frame.queries[event.query + 1], GL_QUERY_RESULT, &end);
+				event.gpuBegin = (double)begin / 1e6 - m_gpuOffset;
+				event.gpuEnd   = (double)end / 1e6 - m_gpuOffset;
+			}
+		}
+	}
+
+	// a zone running several times in a frame counts with its total
+	Sample sample;
+	sample.cpu.assign(m_names.size(), -1.0);
+	sample.gpu.assign(m_names.size(), -1.0);
+	for (const Event& event : frame.events)
+	{
+		double& cpu = sample.cpu[event.zone];
+		cpu = std::max(cpu, 0.0) + (event.cpuEnd - event.cpuBegin);
+		if (event.gpuBegin >= 0.0)
+		{
+			double& gpu = sample.gpu[event.zone];
+			gpu = std::max(gpu, 0.0) + (event.gpuEnd - event.gpuBegin);
+		}
+		m_depths[event.zone] = event.depth;
+	}
+	m_samples.push_back(std::move(sample));
+	if (m_samples.size() > m_window)
+		m_samples.pop_front();
+
+	if (m_traceFrames)
+	{
+		m_trace.push_back(frame.events);
+		if (m_trace.size() > m_traceFrames)
+			m_trace.pop_front();
+	}
+}
+
+std::vector<Profiler::ZoneStats> Profiler::stats() const
+{
+	std::vector<ZoneStats> zones(m_names.size());
+	for (size_t zone = 0; zone < zones.size(); zone++)
+	{
+		zones[zone].name  = m_names[zone];
+		zones[zone].depth = m_depths[zone];
+	}
+
+	for (const Sample& sample : m_samples)
+	{
+		for (size_t zone = 0; zone < sample.cpu.size(); zone++)
+		{
+			if (sample.cpu[zone] < 0.0)
+				continue;
+			ZoneStats& stats = zones[zone];
+			stats.samples++;
+			stats.cpuAvg += sample.cpu[zone];
+			stats.cpuMax  = std::max(stats.cpuMax, sample.cpu[zone]);
+			if (sample.gpu[zone] < 0.0)
+				continue;
+			stats.gpuSamples++;
+			stats.gpuAvg += sample.gpu[zone];
+			stats.gpuMax  = std::max(stats.gpuMax, sample.gpu[zone]);
+		}
+	}
+
+	for (size_t zone = 0; zone < zones.size(); zone++)
+	{
+		if (zones[zone].samples)
+			zones[zone].cpuAvg /= (double)zones[zone].samples;
+		if (zones[zone].gpuSamples)
+			zones[zone].gpuAvg /= (double)zones[zone].gpuSamples;
+	}
+	return zones;
+}
+
+void Profiler::printStats(std::ostream& out) const
+{
+	out << "[PROFILER] last " << m_samples.size() << " frames";
+	if (!m_gpu)
+		out << ", no GPU timestamps on this implementation";
+	else if (m_dropped)
+		out << ", " << m_dropped << " frames without GPU results";
+	out << "\n" << std::left << std::setw(24) << "zone" << std::right
+		<< std::setw(12) << "cpu avg" << std::setw(12) << "cpu max"
+		<< std::setw(12) << "gpu avg" << std::setw(12) << "gpu max" << "  (ms)\n";
+
+	std::ios::fmtflags flags = out.flags();
+	for (const ZoneStats& zone : stats())
+	{
+		out << std::left << std::setw(24) << (std::string(zone.depth * 2, ' ') + zone.name) << std::right
+			<< std::fixed << std::setprecision(3)
+			<< std::setw(12) << zone.cpuAvg << std::setw(12) << zone.cpuMax;
+		if (zone.gpuSamples)
+			out << std::setw(12) << zone.gpuAvg << std::setw(12) << zone.gpuMax << "\n";
+		else
+			out << std::setw(12) << "-" << std::setw(12) << "-" << "\n";
+	}
+	out.flags(flags);
+}
+
+bool Profiler::writeTrace(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "ERROR::PROFILER::FILE_NOT_WRITABLE " << path << "\n";
+		return false;
+	}
+
+	// one process, the CPU zones on thread 1 and the GPU zones on thread 2, times in microseconds
+	file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[\n"
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+		<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	for (const std::vector<Event>& frame : m_trace)
+	{
+		for (const Event& event : frame)
+		{
+			const std::string name = escape(m_names[event.zone]);
+			file << ",\n{\"name\":\"" << name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+				<< ",\"ts\":" << event.cpuBegin * 1000.0 << ",\"dur\":" << (event.cpuEnd - event.cpuBegin) * 1000.0 << "}";
+			if (event.gpuBegin < 0.0)
+				continue;
+			file << ",\n{\"name\":\"" << name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2"
+				<< ",\"ts\":" << event.gpuBegin * 1000.0 << ",\"dur\":" << (event.gpuEnd - event.gpuBegin) * 1000.0 << "}";
+		}
+	}
+	file << "\n]}\n";
+	return (bool)file;
+}
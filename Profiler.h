@@ -0,0 +1,144 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+
+// Core cpp lib
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! @brief CPU and GPU frame profiler built from scoped zones.
+ *
+ *	Wrap a piece of the frame in a Profiler::Scope and it is timed on the
+ *	CPU and, unless asked not to, on the GPU. GPU times come from a pair of
+ *	GL_TIMESTAMP queries per zone rather than GL_TIME_ELAPSED, which can't
+ *	nest. Queries live in FRAMES_IN_FLIGHT pools, a frame's results are
+ *	read when its pool comes round again, and only if the driver already
+ *	has them: the profiler never waits for the GPU, a frame that isn't
+ *	done in time just has no GPU numbers. Only flush(), at the end of a
+ *	run, waits for the frames still in flight.
+ *
+ *	Per zone statistics cover the last `window` resolved frames. The
+ *	resolved frames are also kept (up to a limit) for a Chrome trace,
+ *	CPU zones on one track and GPU zones on another, open it in
+ *	chrome://tracing or ui.perfetto.dev.
+ *
+ *	Only use it on the thread owning the context.
+ */
+class Profiler
+{
+public:
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+
+	class Scope
+	{
+	public:
+		// gpu = false for zones with no GL work worth timing (input, waits, ...)
+		Scope(Profiler&, const char*, bool = true);
+		~Scope();
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		Profiler& m_profiler;
+		size_t    m_event;
+	};
+
+	struct ZoneStats
+	{
+		std::string name;
+		unsigned int depth = 0;	// nesting depth it was last seen at
+		size_t samples     = 0;	// frames in the window the zone ran in
+		size_t gpuSamples  = 0;	// of those, frames with GPU results
+		double cpuAvg = 0.0, cpuMax = 0.0;	// ms per frame
+		double gpuAvg = 0.0, gpuMax = 0.0;	// ms per frame, 0 without GPU data
+	};
+
+	// window: frames the statistics cover, traceFrames: frames kept for writeTrace
+	explicit Profiler(size_t = 120, size_t = 600);
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Bracket every frame, the whole frame is a zone called "frame"
+	void beginFrame();
+	void endFrame();
+
+	// Waits for the frames still in flight and resolves them, call it
+	// after the last endFrame before reading stats or writing the trace
+	void flush();
+
+	// Statistics over the rolling window, in the order zones were first seen
+	std::vector<ZoneStats> stats() const;
+	void printStats(std::ostream&) const;
+
+	// Chrome trace event JSON of the kept frames
+	bool writeTrace(const std::string&) const;
+
+	// Frames whose GPU results weren't ready in time
+	size_t droppedFrames() const { return m_dropped; }
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	struct Event
+	{
+		uint32_t zone;
+		uint32_t depth;
+		double   cpuBegin, cpuEnd;	// ms since the profiler was created
+		double   gpuBegin = -1.0, gpuEnd = -1.0;	// same clock, -1 if not measured
+		GLint    query = -1;		// first of the two timestamp queries in the pool
+	};
+
+	struct Frame
+	{
+		bool     active = false;
+		std::vector<Event>  events;
+		std::vector<GLuint> queries;	// grows to the largest frame seen, reused after that
+		size_t   usedQueries = 0;
+	};
+
+	size_t begin(const char*, bool);
+	void   end(size_t);
+	double now() const;
+
+	// reads back a finished frame, without waiting unless asked to, and feeds the statistics
+	void resolve(Frame&, bool = false);
+
+	Clock::time_point m_start;
+	bool     m_gpu = false;
+	double   m_gpuOffset = 0.0;		// gpu clock ms - cpu clock ms
+	uint64_t m_frame = 0;
+	Frame    m_frames[FRAMES_IN_FLIGHT];
+	Frame*   m_current = nullptr;
+	size_t   m_frameEvent = 0;
+	uint32_t m_depth = 0;
+	size_t   m_dropped = 0;
+
+	std::vector<std::string> m_names;
+	std::unordered_map<std::string, uint32_t> m_zones;
+
+	// per resolved frame: total cpu / gpu ms of every zone (-1 if it didn't run)
+	struct Sample
+	{
+		std::vector<double> cpu;
+		std::vector<double> gpu;
+	};
+	size_t m_window;
+	std::deque<Sample> m_samples;
+	std::vector<uint32_t> m_depths;
+
+	size_t m_traceFrames;
+	std::deque<std::vector<Event>> m_trace;
+};
+
+#endif // !PROFILER_H
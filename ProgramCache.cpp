@@ -0,0 +1,207 @@
+#include "ProgramCache.h"
+
+#include <learnopengl/gl_extensions.h>
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	// header in front of every cached binary
+	struct BinaryHeader
+	{
+		uint32_t magic;			// 'PBIN'
+		uint32_t version;		// bumped whenever the layout changes
+		uint32_t format;		// driver binary format
+		uint32_t length;		// bytes following the header
+		float    compileMs;		// what building the program from source cost
+	};
+
+	const uint32_t BINARY_MAGIC   = 0x4E494250;
+	const uint32_t BINARY_VERSION = 1;
+}
+
+void ProgramCache::setDirectory(const std::string& dir)
+{
+	directory() = dir;
+}
+
+bool ProgramCache::enabled()
+{
+	if (!glext().ARB_get_program_binary)
+		return false;
+
+	// a driver may expose the entry points and still support no format at all
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	return formats > 0;
+}
+
+std::string ProgramCache::key(
+	const std::string& vertexCode,
+	const std::string& fragmentCode,
+	const std::string& geometryCode
+)
+{
+	// separators keep "ab" + "c" and "a" + "bc" apart
+	uint64_t h = 14695981039346656037ull;
+	h = hash(h, vertexCode);
+	h = hash(h, "\x1f");
+	h = hash(h, fragmentCode);
+	h = hash(h, "\x1f");
+	h = hash(h, geometryCode);
+	h = hash(h, "\x1f");
+	// a binary is only valid for the driver that produced it
+	for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+	{
+		const GLubyte* value = glGetString(name);
+		h = hash(h, value ? (const char*)value : "");
+	}
+
+	char hex[17];
+	std::snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+	return hex;
+}
+
+bool ProgramCache::load(GLuint program, const std::string& key)
+{
+	if (!enabled())
+		return false;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::ifstream file(path(key), std::ios::binary);
+	if (!file)
+		return false;
+
+	BinaryHeader header;
+	if (!file.read((char*)&header, sizeof(header)) ||
+		header.magic != BINARY_MAGIC || header.version != BINARY_VERSION)
+		return false;
+
+	std::vector<char> binary(header.length);
+	if (!file.read(binary.data(), (std::streamsize)binary.size()))
+		return false;
+	file.close();
+
+	glext().ProgramBinary(program, (GLenum)header.format, binary.data(), (GLsizei)binary.size());
+
+	GLint success = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success)
+	{
+		// stale or foreign binary, drop it so the fresh one can take its place
+		mutableStats().rejected++;
+		std::remove(path(key).c_str());
+		return false;
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - start).count();
+
+	Stats& stats = mutableStats();
+	stats.hits++;
+	stats.loadMs += ms;
+	if (header.compileMs > ms)
+		stats.savedMs += header.compileMs - ms;
+	return true;
+}
+
+void ProgramCache::prepare(GLuint program)
+{
+	if (enabled())
+		glext().ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramCache::store(GLuint program, const std::string& key, double compileMs)
+{
+	countMiss(compileMs);
+	if (!enabled())
+		return;
+
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	BinaryHeader header;
+	header.magic     = BINARY_MAGIC;
+	header.version   = BINARY_VERSION;
+	header.compileMs = (float)compileMs;
+
+	std::vector<char> binary((size_t)length);
+	GLenum format = 0;
+	GLsizei written = 0;
+	glext().GetProgramBinary(program, length, &written, &format, binary.data());
+	header.format = (uint32_t)format;
+	header.length = (uint32_t)written;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory(), error);
+
+	std::ofstream file(path(key), std::ios::binary | std::ios::trunc);
+	if (!file)
+	{
+		std::cerr << "ERROR::PROGRAM_CACHE::CANNOT_WRITE " << path(key) << "\n";
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), written);
+	mutableStats().stored++;
+}
+
+void ProgramCache::countMiss(double compileMs)
+{
+	Stats& stats = mutableStats();
+	stats.misses++;
+	stats.compileMs += compileMs;
+}
+
+const ProgramCache::Stats& ProgramCache::stats()
+{
+	return mutableStats();
+}
+
+void ProgramCache::printStats(std::ostream& out)
+{
+	const Stats& s = stats();
+	out << "[PROGRAM CACHE] " << (enabled() ? "enabled" : "unavailable")
+		<< ", hits: " << s.hits
+		<< ", misses: " << s.misses
+		<< ", rejected: " << s.rejected
+		<< ", stored: " << s.stored
+		<< ", load: " << s.loadMs << " ms"
+		<< ", compile: " << s.compileMs << " ms"
+		<< ", saved: " << s.savedMs << " ms\n";
+}
+
+std::string& ProgramCache::directory()
+{
+	static std::string dir = "shader_cache";
+	return dir;
+}
+
+ProgramCache::Stats& ProgramCache::mutableStats()
+{
+	static Stats stats;
+	return stats;
+}
+
+std::string ProgramCache::path(const std::string& key)
+{
+	return directory() + "/" + key + ".bin";
+}
+
+uint64_t ProgramCache::hash(uint64_t h, const std::string& text)
+{
+	// FNV-1a 64
+	for (unsigned char c : text)
+	{
+		h ^= c;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
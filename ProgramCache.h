@@ -0,0 +1,64 @@
+#pragma once
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+
+// Core cpp lib
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/*! @brief On-disk cache of linked program binaries.
+ *
+ *	Entries are keyed by a hash of the shader sources together with
+ *	the GL vendor, renderer and version strings, so a driver update or
+ *	a different GPU simply misses instead of feeding the driver a
+ *	binary it can't use. Needs GL 4.1 or GL_ARB_get_program_binary
+ *	(see loadGLExtensions), otherwise every lookup is a miss.
+ */
+class ProgramCache
+{
+public:
+	struct Stats
+	{
+		unsigned int hits     = 0;	// programs restored from a cached binary
+		unsigned int misses   = 0;	// programs compiled from source
+		unsigned int rejected = 0;	// cached binaries the driver refused
+		unsigned int stored   = 0;	// binaries written after a miss
+		double loadMs    = 0.0;		// time spent restoring binaries
+		double compileMs = 0.0;		// time spent compiling on misses
+		double savedMs   = 0.0;		// recorded compile time of the hits minus their load time
+	};
+
+	// Directory the binaries live in, created on first store
+	static void setDirectory(const std::string&);
+
+	// Cache key for the given sources on the current context
+	static std::string key(const std::string&, const std::string&, const std::string& = std::string());
+
+	// Try to link the program from a cached binary, false on a miss or a rejected binary
+	static bool load(GLuint, const std::string&);
+
+	// Must be called before linking a program that will be stored
+	static void prepare(GLuint);
+
+	// Write the binary of a linked program, along with how long it took to build
+	static void store(GLuint, const std::string&, double);
+
+	// Count a program that had to be compiled without being stored
+	static void countMiss(double);
+
+	static bool enabled();
+	static const Stats& stats();
+	static void printStats(std::ostream&);
+
+private:
+	static std::string& directory();
+	static Stats& mutableStats();
+	static std::string path(const std::string&);
+	static uint64_t hash(uint64_t, const std::string&);
+};
+
+#endif // !PROGRAM_CACHE_H
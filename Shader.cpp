@@ -1,4 +1,26 @@
 #include "Shader.h"
+#include "ProgramCache.h"
+#include "UniformBuffer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+
+namespace
+{
+	// one program per (sources, define set), shared by every Shader asking for it
+	struct Permutation
+	{
+		GLuint       program;
+		unsigned int users;
+	};
+
+	std::unordered_map<std::string, Permutation>& permutations()
+	{
+		static std::unordered_map<std::string, Permutation> cache;
+		return cache;
+	}
+}
 
 Shader::Shader(
 	const char* vertexPath,
@@ -6,56 +28,85 @@ Shader::Shader(
 	const char* geometryPath
 )
 {
-	// 1. retrieve the vertex/fragment shader code from filePath
-	std::string   vertexCode;
-	std::string   fragmentCode;
-	std::string   geometryCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	std::ifstream gShaderFile;
+	m_sourcePaths.push_back(vertexPath);
+	m_sourcePaths.push_back(fragmentPath);
+	if (geometryPath)
+		m_sourcePaths.push_back(geometryPath);
 
-	// Ensure that source files can throw exceptions
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	gShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+	// 1. retrieve the vertex/fragment shader code from filePath, includes resolved
+	bool linked;
+	ID = build(loadSources(&m_sourceFiles), linked);
 
-	try
-	{
-		// Open file
-		vShaderFile  .open(vertexPath);
-		fShaderFile  .open(fragmentPath);
+	// reflect the active uniforms so set* never query locations again
+	reflect();
+}
 
-		std::stringstream vShaderStream, fShaderStream;
-		// Read's file buffer content into stream
-		vShaderStream   << vShaderFile.rdbuf();
-		fShaderStream   << fShaderFile.rdbuf();
+Shader::Shader(const char* name, std::initializer_list<const char*> defines)
+	: Shader(std::string(name), std::vector<std::string>(defines.begin(), defines.end()))
+{
+}
 
-		// close the file
-		vShaderFile.close();
-		fShaderFile.close();
+Shader::Shader(const std::string& name, const std::vector<std::string>& defines)
+	: m_defines(ShaderPreprocessor::canonical(defines))
+{
+	m_sourcePaths.push_back(name + ".vs");
+	m_sourcePaths.push_back(name + ".fs");
+	if (std::ifstream(name + ".gs"))
+		m_sourcePaths.push_back(name + ".gs");
 
-		// Convert stream into string
-		vertexCode   = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+	// the key is made from the sources before the defines went in, plus the define set
+	std::vector<ShaderPreprocessor::Result> stages = preprocess();
+	std::string key;
+	for (const ShaderPreprocessor::Result& stage : stages)
+		key += std::to_string(stage.hash) + "/";
+	for (const std::string& define : m_defines)
+		key += "|" + define;
+	std::vector<std::string> sources = collect(std::move(stages), &m_sourceFiles);
 
-		if (geometryPath)
-		{
-			gShaderFile.open(geometryPath);
-			std::stringstream gShaderStream;
-			gShaderStream << gShaderFile.rdbuf();
-			gShaderFile.close();
-			geometryCode = gShaderStream.str();
-		}
-	}
-	catch (std::ifstream::failure& f)
+	auto it = permutations().find(key);
+	if (it != permutations().end())
 	{
-		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ\n";
+		ID = it->second.program;
+		it->second.users++;
+		m_permutation = key;
 	}
-	catch (const std::exception& e)
+	else
 	{
-		std::cerr << e.what() << std::endl;
+		bool linked;
+		ID = build(sources, linked);
+		// a broken permutation is rebuilt (and reported) by the next one asking for it
+		if (linked)
+		{
+			permutations()[key] = Permutation{ ID, 1 };
+			m_permutation = key;
+		}
 	}
 
+	reflect();
+}
+
+Shader::Shader(GLuint program)
+	: ID(program)
+{
+	reflect();
+}
+
+GLuint Shader::build(const std::vector<std::string>& sources, bool& linked)
+{
+	const std::string& vertexCode   = sources[0];
+	const std::string& fragmentCode = sources[1];
+	const bool hasGeometry = sources.size() > 2;
+	const std::string geometryCode = hasGeometry ? sources[2] : std::string();
+
+	// 2. a cached binary of exactly these sources skips compiling and linking
+	const std::string cacheKey = ProgramCache::key(vertexCode, fragmentCode, geometryCode);
+	GLuint program = glCreateProgram();
+	if (ProgramCache::load(program, cacheKey))
+	{
+		linked = true;
+		return program;
+	}
+	auto compileStart = std::chrono::high_resolution_clock::now();
 	/*
 		OpenGLSL shader language.
 		vertex shader code.
@@ -99,7 +150,7 @@ Shader::Shader(
 
 	// geometry
 	GLuint geometry;
-	if (geometryPath)
+	if (hasGeometry)
 	{
 		const GLchar* gShaderCode = geometryCode.c_str();
 		geometry = glCreateShader(GL_GEOMETRY_SHADER);
@@ -109,20 +160,141 @@ Shader::Shader(
 	}
 
 	// 3. shader program
-	ID = glCreateProgram();
 	// Attach all shader linking them into one program
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	if (geometryPath)
-		glAttachShader(ID, geometry);
-	glLinkProgram(ID);
-	checkCompileError(ID, "PROGRAM");
+	glAttachShader(program, vertex);
+	glAttachShader(program, fragment);
+	if (hasGeometry)
+		glAttachShader(program, geometry);
+	// ask the driver to keep the binary around so it can be cached
+	ProgramCache::prepare(program);
+	glLinkProgram(program);
+	linked = checkCompileError(program, "PROGRAM");
+
+	double compileMs = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - compileStart).count();
+	// never cache a program that failed to link
+	if (linked)
+		ProgramCache::store(program, cacheKey, compileMs);
+	else
+		ProgramCache::countMiss(compileMs);
 
 	// Killing the vertex and fragmnet shader
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
-	if (geometryPath)
+	if (hasGeometry)
 		glDeleteShader(geometry);
+	return program;
+}
+
+std::string Shader::readSource(const char* path)
+{
+	std::ifstream shaderFile;
+	// Ensure that source files can throw exceptions
+	shaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+	try
+	{
+		// Read's file buffer content into stream
+		shaderFile.open(path);
+		std::stringstream shaderStream;
+		shaderStream << shaderFile.rdbuf();
+		shaderFile.close();
+
+		// Convert stream into string
+		return shaderStream.str();
+	}
+	catch (std::ifstream::failure&)
+	{
+		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << "\n";
+	}
+	return std::string();
+}
+
+const std::vector<std::string>& Shader::sourcePaths() const
+{
+	return m_sourcePaths;
+}
+
+const std::vector<std::string>& Shader::sourceFiles() const
+{
+	return m_sourceFiles;
+}
+
+const std::vector<std::string>& Shader::defines() const
+{
+	return m_defines;
+}
+
+std::vector<std::string> Shader::loadSources(std::vector<std::string>* files) const
+{
+	return collect(preprocess(), files);
+}
+
+std::vector<ShaderPreprocessor::Result> Shader::preprocess() const
+{
+	return preprocess(m_sourcePaths, m_defines);
+}
+
+std::vector<ShaderPreprocessor::Result> Shader::preprocess(const std::vector<std::string>& paths, const std::vector<std::string>& defines)
+{
+	std::vector<ShaderPreprocessor::Result> stages;
+	for (const std::string& path : paths)
+		stages.push_back(ShaderPreprocessor::process(path, defines));
+	return stages;
+}
+
+std::vector<std::string> Shader::collect(std::vector<ShaderPreprocessor::Result>&& stages, std::vector<std::string>* files)
+{
+	std::vector<std::string> sources;
+	if (files)
+		files->clear();
+	for (ShaderPreprocessor::Result& stage : stages)
+	{
+		sources.push_back(stage.complete ? std::move(stage.source) : std::string());
+		if (!files)
+			continue;
+		for (std::string& file : stage.files)
+			if (std::find(files->begin(), files->end(), file) == files->end())
+				files->push_back(std::move(file));
+	}
+	return sources;
+}
+
+size_t Shader::permutationCount()
+{
+	return permutations().size();
+}
+
+void Shader::release()
+{
+	if (m_permutation.empty())
+	{
+		glDeleteProgram(ID);
+		return;
+	}
+
+	auto it = permutations().find(m_permutation);
+	if (it != permutations().end() && it->second.program == ID && --it->second.users == 0)
+	{
+		glDeleteProgram(ID);
+		permutations().erase(it);
+	}
+	m_permutation.clear();
+}
+
+void Shader::reload(GLuint program)
+{
+	// a reloaded program belongs to this shader alone, the other users keep the shared one
+	release();
+	ID = program;
+	reflect();
+}
+
+void Shader::reflect()
+{
+	m_uniforms.build(ID);
+	// shared blocks (camera, ...) read from their fixed binding points
+	UniformBlocks::bind(ID);
 }
 
 void Shader::use()
@@ -130,20 +302,25 @@ void Shader::use()
 	glUseProgram(ID);
 }
 
+UniformHandle Shader::uniform(const GLchar* name)
+{
+	return m_uniforms.handle(name);
+}
+
 void Shader::setInt(const GLchar* name, GLint val) const
 {
-	glUniform1i(glGetUniformLocation(ID, name), val);
+	glUniform1i(m_uniforms.find(name), val);
 }
 
 void Shader::setFloat(const GLchar* name, GLfloat val) const
 {
-	glUniform1f(glGetUniformLocation(ID, name), val);
+	glUniform1f(m_uniforms.find(name), val);
 }
 
 void Shader::setVec2(const GLchar* name, const glm::vec2& value) const
 {
 	glUniform2fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		1,
 		&value[0]
 	);
@@ -152,7 +329,7 @@ void Shader::setVec2(const GLchar* name, const glm::vec2& value) const
 void Shader::setVec2(const GLchar* name, float x, float y) const
 {
 	glUniform2f(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		x,
 		y
 	);
@@ -161,7 +338,7 @@ void Shader::setVec2(const GLchar* name, float x, float y) const
 void Shader::setVec3(const GLchar* name, const glm::vec3& value) const
 {
 	glUniform3fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		1,
 		&value[0]
 	);
@@ -170,7 +347,7 @@ void Shader::setVec3(const GLchar* name, const glm::vec3& value) const
 void Shader::setVec3(const GLchar* name, float x, float y, float z) const
 {
 	glUniform3f(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		x,
 		y,
 		z
@@ -180,7 +357,7 @@ void Shader::setVec3(const GLchar* name, float x, float y, float z) const
 void Shader::setVec4(const GLchar* name, const glm::vec4& value) const
 {
 	glUniform4fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		1,
 		&value[0]
 	);
@@ -190,7 +367,7 @@ void Shader::setVec4(const GLchar* name,
 	float x, float y, float z, float w) const
 {
 	glUniform4f(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		(GLfloat)x,
 		(GLfloat)y,
 		(GLfloat)z,
@@ -201,7 +378,7 @@ void Shader::setVec4(const GLchar* name,
 void Shader::setMat2(const GLchar* name, const glm::mat2& value) const
 {
 	glUniformMatrix2fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		(GLsizei)1,
 		GL_FALSE,
 		(const GLfloat*)&value[0][0]
@@ -211,7 +388,7 @@ void Shader::setMat2(const GLchar* name, const glm::mat2& value) const
 void Shader::setMat3(const GLchar* name, const glm::mat3& value )const
 {
 	glUniformMatrix3fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		(GLsizei)1,
 		GL_FALSE,
 		(const GLfloat*)&value[0][0]
@@ -221,14 +398,54 @@ void Shader::setMat3(const GLchar* name, const glm::mat3& value )const
 void Shader::setMat4(const GLchar* name, const glm::mat4& value) const
 {
 	glUniformMatrix4fv(
-		glGetUniformLocation(ID, name),
+		m_uniforms.find(name),
 		(GLsizei)1,
 		GL_FALSE,
 		(const GLfloat*)&value[0][0]
 	);
 }
 
-void Shader::checkCompileError(GLuint& shader, std::string&& type) const
+void Shader::setInt(UniformHandle handle, GLint val) const
+{
+	glUniform1i(m_uniforms.location(handle), val);
+}
+
+void Shader::setFloat(UniformHandle handle, GLfloat val) const
+{
+	glUniform1f(m_uniforms.location(handle), val);
+}
+
+void Shader::setVec2(UniformHandle handle, const glm::vec2& value) const
+{
+	glUniform2fv(m_uniforms.location(handle), 1, &value[0]);
+}
+
+void Shader::setVec3(UniformHandle handle, const glm::vec3& value) const
+{
+	glUniform3fv(m_uniforms.location(handle), 1, &value[0]);
+}
+
+void Shader::setVec4(UniformHandle handle, const glm::vec4& value) const
+{
+	glUniform4fv(m_uniforms.location(handle), 1, &value[0]);
+}
+
+void Shader::setMat2(UniformHandle handle, const glm::mat2& value) const
+{
+	glUniformMatrix2fv(m_uniforms.location(handle), (GLsizei)1, GL_FALSE, (const GLfloat*)&value[0][0]);
+}
+
+void Shader::setMat3(UniformHandle handle, const glm::mat3& value) const
+{
+	glUniformMatrix3fv(m_uniforms.location(handle), (GLsizei)1, GL_FALSE, (const GLfloat*)&value[0][0]);
+}
+
+void Shader::setMat4(UniformHandle handle, const glm::mat4& value) const
+{
+	glUniformMatrix4fv(m_uniforms.location(handle), (GLsizei)1, GL_FALSE, (const GLfloat*)&value[0][0]);
+}
+
+bool Shader::checkCompileError(GLuint& shader, std::string&& type)
 {
 	GLint succes;
 	GLchar infoLog[1024];
@@ -245,23 +462,24 @@ void Shader::checkCompileError(GLuint& shader, std::string&& type) const
 				<< "\n -- --------------------------------------------------- -- " 
 				<< std::endl;
 		}
-		else 
+	}
+	else 
+	{
+		// print error if any
+		glGetProgramiv(shader, GL_LINK_STATUS, &succes);
+		if (!succes)
 		{
-			// print error if any
-			glGetProgramiv(shader, GL_LINK_STATUS, &succes);
-			if (!succes)
-			{
-				glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-				std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " 
-					<< type << "\n" << infoLog 
-					<< "\n -- --------------------------------------------------- -- " 
-					<< std::endl;
-			}
+			glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+			std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " 
+				<< type << "\n" << infoLog 
+				<< "\n -- --------------------------------------------------- -- " 
+				<< std::endl;
 		}
 	}
+	return succes == GL_TRUE;
 }
 
 Shader::~Shader()
 {
-	glDeleteProgram(ID);
+	release();
 }
@@ -5,20 +5,58 @@
 // Compiled lib and header
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include <learnopengl/uniform_table.h>
+
+#include "ShaderPreprocessor.h"
 
 // Core cpp lib
 #include <iostream>
 #include <fstream>
+#include <initializer_list>
 #include <string>
 #include <sstream>
+#include <vector>
 
 class Shader
 {
 private:
 
 	// utility function for checking shader compilation/linking errors.
+	// returns true if the shader compiled / the program linked
 	// ------------------------------------------------------------------------
-	void checkCompileError(GLuint&, std::string&&) const;
+	static bool checkCompileError(GLuint&, std::string&&);
+
+	// active uniforms reflected once after link
+	UniformTable m_uniforms;
+
+	// vertex, fragment and (optional) geometry file the program came from
+	std::vector<std::string> m_sourcePaths;
+	// every file the program was built from, includes too
+	std::vector<std::string> m_sourceFiles;
+	// canonical define set injected into every stage
+	std::vector<std::string> m_defines;
+	// key in the permutation cache, empty if the program isn't shared
+	std::string m_permutation;
+
+	// compile + link through the program cache, returns the program even if it failed to link
+	static GLuint build(const std::vector<std::string>&, bool&);
+
+	// every stage through the preprocessor with this shader's defines
+	std::vector<ShaderPreprocessor::Result> preprocess() const;
+	// same for any stage files and defines, touches no Shader so other threads can use it
+	static std::vector<ShaderPreprocessor::Result> preprocess(const std::vector<std::string>&, const std::vector<std::string>&);
+	// stage sources (empty where incomplete), and the files of all stages without duplicates
+	static std::vector<std::string> collect(std::vector<ShaderPreprocessor::Result>&&, std::vector<std::string>*);
+
+	// uniform table and shared uniform block bindings, after every new program
+	void reflect();
+
+	// give the program back to the permutation cache or delete it
+	void release();
+
+	// build programs themselves and check them through checkCompileError
+	friend class ShaderLibrary;
+	friend class ShaderWatcher;
 
 public:
 	// The program id
@@ -30,6 +68,18 @@ public:
 	// Constructor reads and builds the shader
 	explicit Shader(const char*, const char*, const char* = nullptr);
 
+	/*! @brief Permutation of <name>.vs / <name>.fs (and <name>.gs if there is one).
+	 *
+	 *	Shader("lit", {"NORMAL_MAP", "SKINNED"}) builds lit.vs and lit.fs with
+	 *	both defines injected. Shaders asking for the same sources and the
+	 *	same define set, in any order, share one program.
+	 */
+	Shader(const char*, std::initializer_list<const char*>);
+	Shader(const std::string&, const std::vector<std::string>&);
+
+	// Adopts an already linked program, the shader owns it from now on
+	explicit Shader(GLuint);
+
 	// Deactivate copy assignment operator
 	Shader(Shader&) = delete;
 	Shader operator=(Shader&) = delete;
@@ -38,9 +88,32 @@ public:
 	Shader(Shader&&) = delete;
 	Shader operator=(Shader&&) = delete;
 
+	// whole file as a string, empty (and an error printed) if it can't be read
+	static std::string readSource(const char*);
+
+	// vertex, fragment and optional geometry path, empty for a program adopted without any
+	const std::vector<std::string>& sourcePaths() const;
+
+	// source paths plus every file they include
+	const std::vector<std::string>& sourceFiles() const;
+
+	const std::vector<std::string>& defines() const;
+
+	// preprocessed sources of every stage, a stage that can't be fully read comes back empty
+	std::vector<std::string> loadSources(std::vector<std::string>* = nullptr) const;
+
+	// number of distinct permutations currently alive
+	static size_t permutationCount();
+
+	// swap in a freshly linked program and drop (or release) the old one, uniform handles stay valid
+	void reload(GLuint);
+
 	// use/activate the shader
 	void use();
 
+	// resolve a uniform once, use the handle in hot loops
+	UniformHandle uniform(const GLchar*);
+
 	// utility uniform function
 	void setInt(const GLchar*, GLint) const;
 	void setFloat(const GLchar*, GLfloat) const;
@@ -54,6 +127,16 @@ public:
 	void setMat3(const GLchar*, const glm::mat3&) const;
 	void setMat4(const GLchar*, const glm::mat4&) const;
 
+	// handle based uniform function, no name lookup at all
+	void setInt(UniformHandle, GLint) const;
+	void setFloat(UniformHandle, GLfloat) const;
+	void setVec2(UniformHandle, const glm::vec2&) const;
+	void setVec3(UniformHandle, const glm::vec3&) const;
+	void setVec4(UniformHandle, const glm::vec4&) const;
+	void setMat2(UniformHandle, const glm::mat2&) const;
+	void setMat3(UniformHandle, const glm::mat3&) const;
+	void setMat4(UniformHandle, const glm::mat4&) const;
+
 	// Default destructor
 	~Shader();
 };
@@ -1,15 +1,24 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+#ifdef INSTANCED
+// per instance model matrix, a mat4 takes locations 2 to 5
+layout (location = 2) in mat4 aModel;
+#endif
+
+#include "camera.glsl"
 
 out vec2 TexCoord;
 
+#ifdef INSTANCED
+#define MODEL aModel
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#define MODEL model
+#endif
 
 void main()
 {
-	gl_Position = projection * view * model * vec4(aPos, 1.f);
+	gl_Position = camera.viewProjection * MODEL * vec4(aPos, 1.f);
 	TexCoord    = vec2(aTexCoord.x, aTexCoord.y);
 }
\ No newline at end of file
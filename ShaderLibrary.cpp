@@ -0,0 +1,193 @@
+#include "ShaderLibrary.h"
+#include "ProgramCache.h"
+
+#include <learnopengl/gl_extensions.h>
+
+#include <stdexcept>
+
+ShaderLibrary::ShaderLibrary(unsigned int threads)
+	: m_pool(threads)
+{
+	// let the driver pick how many compiler threads to use
+	if (glext().KHR_parallel_shader_compile)
+		glext().MaxShaderCompilerThreads(0xFFFFFFFF);
+}
+
+ShaderLibrary::~ShaderLibrary()
+{
+	// programs that were never fetched still own their objects
+	for (auto& entry : m_entries)
+	{
+		if (entry->shader)
+			continue;
+		if (entry->sources.valid())
+			entry->sources.wait();
+		if (entry->vertex)   glDeleteShader(entry->vertex);
+		if (entry->fragment) glDeleteShader(entry->fragment);
+		if (entry->geometry) glDeleteShader(entry->geometry);
+		if (entry->program)  glDeleteProgram(entry->program);
+	}
+}
+
+ShaderLibrary::Handle ShaderLibrary::add(
+	const std::string& name,
+	const char* vertexPath,
+	const char* fragmentPath,
+	const char* geometryPath,
+	const std::vector<std::string>& defines
+)
+{
+	std::unique_ptr<Entry> entry(new Entry());
+	entry->name        = name;
+	entry->defines     = ShaderPreprocessor::canonical(defines);
+	entry->hasGeometry = geometryPath != nullptr;
+	entry->paths.push_back(vertexPath);
+	entry->paths.push_back(fragmentPath);
+	if (geometryPath)
+		entry->paths.push_back(geometryPath);
+
+	// the paths have to outlive the caller's pointers
+	std::string vs = vertexPath, fs = fragmentPath, gs = geometryPath ? geometryPath : "";
+	std::vector<std::string> stageDefines = entry->defines;
+	entry->sources = m_pool.submit([vs, fs, gs, stageDefines]()
+		{
+			// same front-end as Shader, includes resolved on the worker
+			Sources sources;
+			std::vector<ShaderPreprocessor::Result> stages;
+			stages.push_back(ShaderPreprocessor::process(vs, stageDefines));
+			stages.push_back(ShaderPreprocessor::process(fs, stageDefines));
+			if (!gs.empty())
+				stages.push_back(ShaderPreprocessor::process(gs, stageDefines));
+			std::vector<std::string> code = Shader::collect(std::move(stages), &sources.files);
+			sources.vertex   = code[0];
+			sources.fragment = code[1];
+			if (!gs.empty())
+				sources.geometry = code[2];
+			return sources;
+		});
+
+	Handle handle = (Handle)m_entries.size();
+	m_entries.push_back(std::move(entry));
+	m_names[name] = handle;
+	return handle;
+}
+
+void ShaderLibrary::compileAll()
+{
+	for (auto& entry : m_entries)
+		if (!entry->submitted)
+			submit(*entry);
+}
+
+bool ShaderLibrary::ready(Handle handle) const
+{
+	const Entry& entry = *m_entries.at(handle);
+	if (entry.shader || entry.fromCache)
+		return true;
+	if (!entry.submitted)
+		return false;
+	// without the extension there is no way to ask without blocking
+	if (!glext().KHR_parallel_shader_compile)
+		return true;
+
+	GLint done = GL_FALSE;
+	glGetProgramiv(entry.program, GL_COMPLETION_STATUS_KHR, &done);
+	return done == GL_TRUE;
+}
+
+Shader& ShaderLibrary::get(Handle handle)
+{
+	Entry& entry = *m_entries.at(handle);
+	if (!entry.submitted)
+		submit(entry);
+	if (!entry.shader)
+		finish(entry);
+	return *entry.shader;
+}
+
+Shader& ShaderLibrary::get(const std::string& name)
+{
+	return get(find(name));
+}
+
+ShaderLibrary::Handle ShaderLibrary::find(const std::string& name) const
+{
+	auto it = m_names.find(name);
+	if (it == m_names.end())
+		throw std::out_of_range("ShaderLibrary: no program named " + name);
+	return it->second;
+}
+
+void ShaderLibrary::submit(Entry& entry)
+{
+	Sources sources = entry.sources.get();
+	entry.files      = std::move(sources.files);
+	entry.submitted  = true;
+	entry.submitTime = std::chrono::high_resolution_clock::now();
+
+	entry.program  = glCreateProgram();
+	entry.cacheKey = ProgramCache::key(sources.vertex, sources.fragment, sources.geometry);
+	if (ProgramCache::load(entry.program, entry.cacheKey))
+	{
+		entry.fromCache = true;
+		return;
+	}
+
+	// compile every stage, statuses are left for finish()
+	const GLchar* code = sources.vertex.c_str();
+	entry.vertex = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(entry.vertex, 1, &code, NULL);
+	glCompileShader(entry.vertex);
+
+	code = sources.fragment.c_str();
+	entry.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(entry.fragment, 1, &code, NULL);
+	glCompileShader(entry.fragment);
+
+	if (entry.hasGeometry)
+	{
+		code = sources.geometry.c_str();
+		entry.geometry = glCreateShader(GL_GEOMETRY_SHADER);
+		glShaderSource(entry.geometry, 1, &code, NULL);
+		glCompileShader(entry.geometry);
+	}
+
+	glAttachShader(entry.program, entry.vertex);
+	glAttachShader(entry.program, entry.fragment);
+	if (entry.geometry)
+		glAttachShader(entry.program, entry.geometry);
+	ProgramCache::prepare(entry.program);
+	glLinkProgram(entry.program);
+}
+
+void ShaderLibrary::finish(Entry& entry)
+{
+	if (!entry.fromCache)
+	{
+		// this is the first status query for the program, and the only one that may block
+		Shader::checkCompileError(entry.vertex, "VERTEX");
+		Shader::checkCompileError(entry.fragment, "FRAGMENT");
+		if (entry.geometry)
+			Shader::checkCompileError(entry.geometry, "GEOMETRY");
+		const bool linked = Shader::checkCompileError(entry.program, "PROGRAM");
+
+		// wall time since submission, overlapping with every other program in flight
+		double compileMs = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - entry.submitTime).count();
+		if (linked)
+			ProgramCache::store(entry.program, entry.cacheKey, compileMs);
+		else
+			ProgramCache::countMiss(compileMs);
+
+		glDeleteShader(entry.vertex);
+		glDeleteShader(entry.fragment);
+		if (entry.geometry)
+			glDeleteShader(entry.geometry);
+		entry.vertex = entry.fragment = entry.geometry = 0;
+	}
+
+	entry.shader.reset(new Shader(entry.program));
+	entry.shader->m_sourcePaths = entry.paths;
+	entry.shader->m_sourceFiles = entry.files;
+	entry.shader->m_defines     = entry.defines;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+#include <learnopengl/thread_pool.h>
+
+// Core cpp lib
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+/*! @brief Builds many programs at once without serializing on the driver.
+ *
+ *	add() reads the source files on a worker pool and returns a handle
+ *	right away. compileAll() then submits every compile and link in one
+ *	go and never asks for a status, so the driver is free to work on all
+ *	of them in parallel (more so with GL_KHR_parallel_shader_compile).
+ *	Statuses are only checked when a program is fetched with get(),
+ *	which blocks for that program alone. Startup then costs about the
+ *	slowest compile instead of the sum of all of them.
+ *
+ *	Every GL call happens on the thread that calls compileAll()/get(),
+ *	the pool only ever touches files.
+ */
+class ShaderLibrary
+{
+public:
+	typedef unsigned int Handle;
+
+	// 0 workers picks one per hardware thread
+	explicit ShaderLibrary(unsigned int = 0);
+	~ShaderLibrary();
+
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	// Queue a program, its files are read (and preprocessed with the defines) in the background
+	Handle add(const std::string&, const char*, const char*, const char* = nullptr,
+		const std::vector<std::string>& = std::vector<std::string>());
+
+	// Submit compile + link of everything queued so far, no status queries
+	void compileAll();
+
+	// True once get() would not block (always true without the parallel compile extension)
+	bool ready(Handle) const;
+
+	// Finished program, checks its status on first access
+	Shader& get(Handle);
+	Shader& get(const std::string&);
+
+	// Handle of a program added under this name
+	Handle find(const std::string&) const;
+
+	size_t size() const { return m_entries.size(); }
+
+private:
+	struct Sources
+	{
+		std::string vertex;
+		std::string fragment;
+		std::string geometry;
+		std::vector<std::string> files;	// every file read, includes too
+	};
+
+	struct Entry
+	{
+		std::string              name;
+		std::vector<std::string> paths;
+		std::vector<std::string> files;
+		std::vector<std::string> defines;
+		bool                     hasGeometry = false;
+		std::future<Sources>     sources;
+		std::string              cacheKey;
+		GLuint                   program  = 0;
+		GLuint                   vertex   = 0;
+		GLuint                   fragment = 0;
+		GLuint                   geometry = 0;
+		bool                     submitted = false;
+		bool                     fromCache = false;
+		std::chrono::high_resolution_clock::time_point submitTime;
+		std::unique_ptr<Shader>  shader;
+	};
+
+	// issues the GL work of one entry
+	void submit(Entry&);
+	// checks statuses, releases the stage objects and wraps the program
+	void finish(Entry&);
+
+	ThreadPool                              m_pool;
+	std::vector<std::unique_ptr<Entry>>     m_entries;
+	std::unordered_map<std::string, Handle> m_names;
+};
+
+#endif // !SHADER_LIBRARY_H
@@ -0,0 +1,175 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+	bool readFile(const std::string& path, std::string& text)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+			return false;
+		std::stringstream stream;
+		stream << file.rdbuf();
+		text = stream.str();
+		return true;
+	}
+
+	// FNV-1a, only has to tell sources apart within one run
+	uint64_t hashSource(const std::string& text)
+	{
+		uint64_t hash = 14695981039346656037ull;
+		for (unsigned char c : text)
+		{
+			hash ^= c;
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	// "#  include" -> position right after the directive name, npos if the line isn't that directive
+	size_t directive(const std::string& line, const char* name)
+	{
+		size_t hash = line.find_first_not_of(" \t");
+		if (hash == std::string::npos || line[hash] != '#')
+			return std::string::npos;
+		size_t word = line.find_first_not_of(" \t", hash + 1);
+		size_t length = std::char_traits<char>::length(name);
+		if (word == std::string::npos || line.compare(word, length, name) != 0)
+			return std::string::npos;
+		return word + length;
+	}
+}
+
+ShaderPreprocessor::Result ShaderPreprocessor::process(
+	const std::string& path,
+	const std::vector<std::string>& defines
+)
+{
+	Result result;
+	result.files.push_back(std::filesystem::path(path).lexically_normal().generic_string());
+
+	std::string body;
+	if (!readFile(path, body))
+	{
+		std::cerr << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ " << path << "\n";
+		result.complete = false;
+		return result;
+	}
+	std::string expanded;
+	expand(body, result, expanded);
+	result.hash = hashSource(expanded);
+
+	if (defines.empty())
+	{
+		result.source = std::move(expanded);
+		return result;
+	}
+
+	std::string block;
+	for (const std::string& define : canonical(defines))
+	{
+		std::string text = define;
+		std::replace(text.begin(), text.end(), '=', ' ');
+		block += "#define " + text + "\n";
+	}
+
+	// #version has to stay the first thing the compiler sees, without one the defines go on top
+	size_t split = 0;
+	int line = 1;
+	for (size_t start = 0; start < expanded.size();)
+	{
+		size_t next = expanded.find('\n', start);
+		next = next == std::string::npos ? expanded.size() : next + 1;
+		std::string current = expanded.substr(start, next - start);
+		if (directive(current, "version") != std::string::npos)
+		{
+			split = next;
+			line++;
+			break;
+		}
+		if (current.find_first_not_of(" \t\r\n") != std::string::npos)
+			break;
+		start = next;
+		line++;
+	}
+	if (split == 0)
+		line = 1;
+
+	result.source = expanded.substr(0, split) + (split && expanded[split - 1] != '\n' ? "\n" : "")
+		+ block + "#line " + std::to_string(line) + " 0\n" + expanded.substr(split);
+	return result;
+}
+
+std::vector<std::string> ShaderPreprocessor::canonical(std::vector<std::string> defines)
+{
+	std::sort(defines.begin(), defines.end());
+	defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+	return defines;
+}
+
+void ShaderPreprocessor::expand(const std::string& text, Result& result, std::string& out)
+{
+	const size_t index = result.files.size() - 1;
+	const std::filesystem::path directory = std::filesystem::path(result.files[index]).parent_path();
+
+	std::istringstream lines(text);
+	std::string line;
+	int number = 0;
+	while (std::getline(lines, line))
+	{
+		number++;
+
+		size_t end = directive(line, "include");
+		if (end != std::string::npos)
+		{
+			size_t open  = line.find_first_of("\"<", end);
+			size_t close = open == std::string::npos ? open : line.find_first_of("\">", open + 1);
+			if (close == std::string::npos)
+			{
+				std::cerr << "ERROR::SHADER::MALFORMED_INCLUDE " << result.files[index] << "(" << number << ")\n";
+				result.complete = false;
+				out += "\n";
+				continue;
+			}
+
+			std::string path = (directory / line.substr(open + 1, close - open - 1)).lexically_normal().generic_string();
+			// once per stage, which also ends include cycles
+			if (std::find(result.files.begin(), result.files.end(), path) != result.files.end())
+			{
+				out += "\n";
+				continue;
+			}
+
+			// recorded even when missing, whoever watches the files sees it appear
+			result.files.push_back(path);
+			std::string included;
+			if (!readFile(path, included))
+			{
+				std::cerr << "ERROR::SHADER::INCLUDE_NOT_FOUND " << path
+					<< " included from " << result.files[index] << "(" << number << ")\n";
+				result.complete = false;
+				out += "\n";
+				continue;
+			}
+			out += "#line 1 " + std::to_string(result.files.size() - 1) + "\n";
+			expand(included, result, out);
+			out += "#line " + std::to_string(number + 1) + " " + std::to_string(index) + "\n";
+			continue;
+		}
+
+		// only the top file gets to pick the version
+		if (index > 0 && (directive(line, "version") != std::string::npos || directive(line, "pragma once") != std::string::npos))
+		{
+			out += "\n";
+			continue;
+		}
+
+		out += line;
+		out += "\n";
+	}
+}
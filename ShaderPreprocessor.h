@@ -0,0 +1,45 @@
+#pragma once
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+// Core cpp lib
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! @brief GLSL front-end: #include resolution and #define injection.
+ *
+ *	`#include "file"` is resolved relative to the file containing it and
+ *	pasted in place. Every file is pasted at most once per stage, so shared
+ *	snippets need no include guards and cycles end by themselves. The
+ *	defines go right after the `#version` line, "NAME" becomes
+ *	`#define NAME` and "NAME=VALUE" becomes `#define NAME VALUE`.
+ *
+ *	`#line` directives keep the driver's error messages pointing at the
+ *	right place: the source string number in "0(12)" / "0:12" is the index
+ *	into Result::files.
+ *
+ *	Only touches files, safe to call from any thread.
+ */
+class ShaderPreprocessor
+{
+public:
+	struct Result
+	{
+		std::string source;				// ready for glShaderSource, empty if the file can't be read
+		std::vector<std::string> files;	// the file itself, then every include in the order they were pasted
+		uint64_t hash = 0;				// hash of the source before the defines were injected
+		bool complete = true;			// false if an include was missing
+	};
+
+	// Expand one stage with the given defines
+	static Result process(const std::string&, const std::vector<std::string>& = std::vector<std::string>());
+
+	// Sorted and without duplicates, the same set always gives the same source
+	static std::vector<std::string> canonical(std::vector<std::string>);
+
+private:
+	static void expand(const std::string&, Result&, std::string&);
+};
+
+#endif // !SHADER_PREPROCESSOR_H
@@ -0,0 +1,377 @@
+#include "ShaderWatcher.h"
+#include "ProgramCache.h"
+
+#include <learnopengl/gl_extensions.h>
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// editors emit several events per save, wait for them to settle before reading
+	const std::chrono::milliseconds SETTLE_TIME(50);
+	// how often the thread wakes up to check for shutdown (and, without inotify, for changes)
+	const std::chrono::milliseconds WAKE_INTERVAL(100);
+
+	const GLenum STAGE_TYPES[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER };
+	const char*  STAGE_NAMES[] = { "VERTEX", "FRAGMENT", "GEOMETRY" };
+
+	std::string absolutePath(const std::string& path)
+	{
+		std::error_code error;
+		std::filesystem::path absolute = std::filesystem::absolute(path, error);
+		return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+	}
+
+	std::filesystem::file_time_type writeTime(const std::string& path)
+	{
+		std::error_code error;
+		return std::filesystem::last_write_time(path, error);
+	}
+}
+
+ShaderWatcher::ShaderWatcher()
+	: m_running(true)
+{
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (m_inotify < 0)
+		std::cerr << "ERROR::SHADER_WATCHER::INOTIFY_UNAVAILABLE, falling back to polling\n";
+#endif
+	m_thread = std::thread([this] { run(); });
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+	m_running = false;
+	m_thread.join();
+
+	for (Build& build : m_building)
+	{
+		for (GLuint stage : build.stages)
+			glDeleteShader(stage);
+		glDeleteProgram(build.program);
+	}
+
+#ifdef __linux__
+	if (m_inotify >= 0)
+		close(m_inotify);
+#endif
+}
+
+void ShaderWatcher::watch(Shader& shader)
+{
+	Watched watched;
+	watched.shader = &shader;
+	watched.stages = shader.sourcePaths();
+	watched.defines = shader.defines();
+	// includes too, editing a shared snippet rebuilds every shader using it
+	const std::vector<std::string>& files = shader.sourceFiles().empty() ? shader.sourcePaths() : shader.sourceFiles();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	setFiles(watched, files);
+	m_watched.push_back(std::move(watched));
+}
+
+void ShaderWatcher::setFiles(Watched& watched, const std::vector<std::string>& files)
+{
+	watched.paths.clear();
+	watched.stamps.clear();
+	for (const std::string& path : files)
+	{
+		watched.paths.push_back(absolutePath(path));
+		watched.stamps.push_back(writeTime(watched.paths.back()));
+	}
+
+#ifdef __linux__
+	// watch directories rather than files, editors often save by replacing the file
+	for (const std::string& path : watched.paths)
+	{
+		std::string directory = std::filesystem::path(path).parent_path().string();
+		if (m_inotify < 0 || m_directories.count(directory))
+			continue;
+		int descriptor = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+		if (descriptor >= 0)
+			m_directories[directory] = descriptor;
+	}
+#endif
+}
+
+void ShaderWatcher::unwatch(Shader& shader)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_watched.erase(std::remove_if(m_watched.begin(), m_watched.end(),
+			[&](const Watched& w) { return w.shader == &shader; }), m_watched.end());
+		m_dirty.erase(std::remove(m_dirty.begin(), m_dirty.end(), &shader), m_dirty.end());
+		m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+			[&](const Pending& p) { return p.shader == &shader; }), m_pending.end());
+	}
+
+	for (auto it = m_building.begin(); it != m_building.end();)
+	{
+		if (it->shader != &shader)
+		{
+			++it;
+			continue;
+		}
+		for (GLuint stage : it->stages)
+			glDeleteShader(stage);
+		glDeleteProgram(it->program);
+		it = m_building.erase(it);
+	}
+}
+
+unsigned int ShaderWatcher::poll(std::vector<Shader*>* swapped)
+{
+	const bool parallel = glext().KHR_parallel_shader_compile;
+	unsigned int count = 0;
+	auto swap = [&](Build& build)
+	{
+		if (!finish(build))
+			return;
+		count++;
+		if (swapped)
+			swapped->push_back(build.shader);
+	};
+
+	// 1. builds from earlier frames, only the ones the driver reports as done
+	for (auto it = m_building.begin(); it != m_building.end();)
+	{
+		GLint done = GL_TRUE;
+		if (parallel && !it->stages.empty())
+			glGetProgramiv(it->program, GL_COMPLETION_STATUS_KHR, &done);
+		if (!done)
+		{
+			++it;
+			continue;
+		}
+		swap(*it);
+		it = m_building.erase(it);
+	}
+
+	// 2. new sources, at most one build per shader in flight
+	std::vector<Pending> pending;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto it = m_pending.begin(); it != m_pending.end();)
+		{
+			Shader* shader = it->shader;
+			bool busy = std::any_of(m_building.begin(), m_building.end(),
+				[&](const Build& b) { return b.shader == shader; });
+			if (busy)
+			{
+				++it;
+				continue;
+			}
+			pending.push_back(std::move(*it));
+			it = m_pending.erase(it);
+		}
+	}
+	for (const Pending& p : pending)
+		submit(p);
+
+	// without the extension the status query blocks anyway, so take the hit in this frame and not a random later one
+	if (!parallel)
+	{
+		for (Build& build : m_building)
+			swap(build);
+		m_building.clear();
+	}
+	return count;
+}
+
+void ShaderWatcher::run()
+{
+	Clock::time_point lastChange = Clock::now();
+	bool changed = false;
+
+	while (m_running)
+	{
+#ifdef __linux__
+		if (m_inotify >= 0)
+		{
+			pollfd descriptor = { m_inotify, POLLIN, 0 };
+			if (::poll(&descriptor, 1, (int)WAKE_INTERVAL.count()) > 0)
+			{
+				alignas(inotify_event) char buffer[4096];
+				ssize_t length;
+				while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+				{
+					std::lock_guard<std::mutex> lock(m_mutex);
+					for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len)
+					{
+						const inotify_event* event = (const inotify_event*)p;
+						if (!event->len)
+							continue;
+						for (const auto& directory : m_directories)
+						{
+							if (directory.second != event->wd)
+								continue;
+							if (touched(absolutePath(directory.first + "/" + event->name)))
+							{
+								changed = true;
+								lastChange = Clock::now();
+							}
+						}
+					}
+				}
+			}
+		}
+		else
+#endif
+		{
+			std::this_thread::sleep_for(WAKE_INTERVAL);
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for (Watched& watched : m_watched)
+			{
+				for (size_t i = 0; i < watched.paths.size(); i++)
+				{
+					std::filesystem::file_time_type stamp = writeTime(watched.paths[i]);
+					if (stamp == watched.stamps[i])
+						continue;
+					watched.stamps[i] = stamp;
+					touched(watched.paths[i]);
+					changed = true;
+					lastChange = Clock::now();
+				}
+			}
+		}
+
+		if (changed && Clock::now() - lastChange >= SETTLE_TIME)
+		{
+			changed = false;
+			readDirty();
+		}
+	}
+}
+
+bool ShaderWatcher::touched(const std::string& path)
+{
+	bool any = false;
+	for (const Watched& watched : m_watched)
+	{
+		if (std::find(watched.paths.begin(), watched.paths.end(), path) == watched.paths.end())
+			continue;
+		if (std::find(m_dirty.begin(), m_dirty.end(), watched.shader) == m_dirty.end())
+			m_dirty.push_back(watched.shader);
+		any = true;
+	}
+	return any;
+}
+
+void ShaderWatcher::readDirty()
+{
+	std::vector<Watched> dirty;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (Shader* shader : m_dirty)
+			for (const Watched& watched : m_watched)
+				if (watched.shader == shader)
+					dirty.push_back(watched);
+		m_dirty.clear();
+	}
+
+	// file IO stays on this thread, the render thread only ever gets complete sources
+	for (const Watched& watched : dirty)
+	{
+		Pending pending;
+		pending.shader = watched.shader;
+		std::vector<std::string> files;
+		pending.sources = Shader::collect(Shader::preprocess(watched.stages, watched.defines), &files);
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto current = std::find_if(m_watched.begin(), m_watched.end(),
+			[&](const Watched& w) { return w.shader == pending.shader; });
+		// unwatched while we were reading
+		if (current == m_watched.end())
+			continue;
+		// the edit may have added or dropped includes
+		std::vector<std::string> absolute;
+		for (const std::string& file : files)
+			absolute.push_back(absolutePath(file));
+		if (absolute != current->paths)
+			setFiles(*current, files);
+
+		// caught mid save or an include is missing, the next event brings it back
+		if (std::any_of(pending.sources.begin(), pending.sources.end(),
+			[](const std::string& source) { return source.empty(); }))
+			continue;
+		// a newer read replaces one that wasn't picked up yet
+		m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(),
+			[&](const Pending& p) { return p.shader == pending.shader; }), m_pending.end());
+		m_pending.push_back(std::move(pending));
+	}
+}
+
+void ShaderWatcher::submit(const Pending& pending)
+{
+	const std::vector<std::string>& sources = pending.sources;
+
+	Build build;
+	build.shader   = pending.shader;
+	build.start    = std::chrono::high_resolution_clock::now();
+	build.program  = glCreateProgram();
+	build.cacheKey = ProgramCache::key(sources[0], sources[1], sources.size() > 2 ? sources[2] : std::string());
+
+	// reverting to an earlier version is a cache hit, no stages to wait for
+	if (!ProgramCache::load(build.program, build.cacheKey))
+	{
+		for (size_t i = 0; i < sources.size() && i < 3; i++)
+		{
+			const GLchar* code = sources[i].c_str();
+			GLuint stage = glCreateShader(STAGE_TYPES[i]);
+			glShaderSource(stage, 1, &code, NULL);
+			glCompileShader(stage);
+			glAttachShader(build.program, stage);
+			build.stages.push_back(stage);
+		}
+		ProgramCache::prepare(build.program);
+		glLinkProgram(build.program);
+	}
+	m_building.push_back(std::move(build));
+}
+
+bool ShaderWatcher::finish(Build& build)
+{
+	std::string name;
+	for (const std::string& path : build.shader->sourcePaths())
+		name += (name.empty() ? "" : ", ") + path;
+
+	bool linked = true;
+	if (!build.stages.empty())
+	{
+		for (size_t i = 0; i < build.stages.size(); i++)
+			Shader::checkCompileError(build.stages[i], STAGE_NAMES[i]);
+		linked = Shader::checkCompileError(build.program, "PROGRAM");
+
+		double compileMs = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - build.start).count();
+		if (linked)
+			ProgramCache::store(build.program, build.cacheKey, compileMs);
+		else
+			ProgramCache::countMiss(compileMs);
+
+		for (GLuint stage : build.stages)
+			glDeleteShader(stage);
+		build.stages.clear();
+	}
+
+	if (!linked)
+	{
+		std::cerr << "[SHADER WATCHER] " << name << " failed to build, keeping the previous program\n";
+		glDeleteProgram(build.program);
+		return false;
+	}
+
+	build.shader->reload(build.program);
+	std::cout << "[SHADER WATCHER] reloaded " << name << "\n";
+	return true;
+}
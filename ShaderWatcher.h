@@ -0,0 +1,104 @@
+#pragma once
+#ifndef SHADER_WATCHER_H
+#define SHADER_WATCHER_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+
+// Core cpp lib
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Shader.h"
+
+/*! @brief Rebuilds shaders whose source files change on disk.
+ *
+ *	A background thread waits for file changes (inotify on Linux,
+ *	modification times everywhere else) and reads the new sources.
+ *	Files pulled in with #include are watched as well.
+ *	poll() runs on the render thread once per frame, submits the
+ *	compile + link and swaps the program into the Shader once it
+ *	linked. With GL_KHR_parallel_shader_compile the build completes
+ *	over the following frames without ever blocking; without it the
+ *	whole build happens inside the one poll() that submits it. A
+ *	program that fails to build is dropped and the old one stays.
+ *
+ *	Call unwatch() before a watched Shader is destroyed.
+ */
+class ShaderWatcher
+{
+public:
+	ShaderWatcher();
+	~ShaderWatcher();
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+	// Start watching the source files of the shader
+	void watch(Shader&);
+	void unwatch(Shader&);
+
+	// Call at the frame boundary on the thread owning the context, returns the number of programs swapped in.
+	// A new program starts with every uniform at its default: the shaders swapped in are appended to swapped,
+	// set the values that are only set once (sampler units, ...) again on those
+	unsigned int poll(std::vector<Shader*>* swapped = nullptr);
+
+private:
+	// sources read by the watcher thread, waiting for the render thread
+	struct Pending
+	{
+		Shader*                  shader;
+		std::vector<std::string> sources;
+	};
+
+	// build submitted to the driver, owned by the render thread
+	struct Build
+	{
+		Shader* shader;
+		GLuint  program;
+		std::vector<GLuint> stages;
+		std::string cacheKey;
+		std::chrono::high_resolution_clock::time_point start;
+	};
+
+	struct Watched
+	{
+		Shader* shader;	// only dereferenced on the render thread
+		// copied in watch(): the watcher thread reads sources from these, never from a Shader that may be gone
+		std::vector<std::string> stages;	// vertex, fragment (, geometry) file
+		std::vector<std::string> defines;
+		std::vector<std::string> paths;	// absolute
+		std::vector<std::filesystem::file_time_type> stamps;	// last seen write times
+	};
+
+	// replaces the files of a watched shader, called with the lock held
+	void setFiles(Watched&, const std::vector<std::string>&);
+
+	void run();
+	// marks every shader using the file dirty, called with the lock held
+	bool touched(const std::string&);
+	// reads the sources of the dirty shaders and queues them for poll()
+	void readDirty();
+
+	void submit(const Pending&);
+	bool finish(Build&);
+
+	std::mutex                 m_mutex;
+	std::vector<Watched>       m_watched;	// guarded
+	std::vector<Shader*>       m_dirty;		// guarded
+	std::vector<Pending>       m_pending;	// guarded
+	std::vector<Build>         m_building;	// render thread only
+
+	std::atomic<bool>          m_running;
+	std::thread                m_thread;
+	int                        m_inotify = -1;
+	std::unordered_map<std::string, int> m_directories;	// guarded, directory -> watch descriptor
+};
+
+#endif // !SHADER_WATCHER_H
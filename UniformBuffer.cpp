@@ -0,0 +1,21 @@
+#include "UniformBuffer.h"
+
+namespace
+{
+	const char* BLOCK_NAMES[UniformBlocks::COUNT] = { "Camera", "BonePalette" };
+}
+
+void UniformBlocks::bind(GLuint program)
+{
+	for (GLuint binding = 0; binding < COUNT; binding++)
+	{
+		GLuint index = glGetUniformBlockIndex(program, BLOCK_NAMES[binding]);
+		if (index != GL_INVALID_INDEX)
+			glUniformBlockBinding(program, index, binding);
+	}
+}
+
+const char* UniformBlocks::name(Binding binding)
+{
+	return BLOCK_NAMES[binding];
+}
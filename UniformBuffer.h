@@ -0,0 +1,102 @@
+#pragma once
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+// Compiled lib and header
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+/*! @brief Fixed binding points of the uniform blocks shared by every program.
+ *
+ *	GLSL 3.30 can't pick a block binding in the shader, so Shader calls
+ *	bind() after every link: each block below that the program declares
+ *	is pointed at its binding point. A buffer bound there once per frame
+ *	then feeds every program at once.
+ */
+class UniformBlocks
+{
+public:
+	enum Binding : GLuint
+	{
+		CAMERA = 0,	// "Camera", see camera.glsl / CameraData
+		BONE_PALETTE,	// "BonePalette", see bone_palette.glsl / BonePaletteBuffer
+		COUNT
+	};
+
+	// Hook the blocks the program declares up to their binding points
+	static void bind(GLuint);
+
+	// Block name in GLSL
+	static const char* name(Binding);
+};
+
+/*! @brief std140 mirror of the Camera block in camera.glsl.
+ *
+ *	Only mat4 and vec4 members, so the C++ layout matches std140 without
+ *	any padding. Keep both in sync.
+ */
+struct CameraData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 position;	// world space, w unused
+
+	static CameraData from(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position)
+	{
+		CameraData data;
+		data.view           = view;
+		data.projection     = projection;
+		data.viewProjection = projection * view;
+		data.position       = glm::vec4(position, 1.f);
+		return data;
+	}
+};
+static_assert(sizeof(CameraData) == 3 * 64 + 16, "CameraData has to match the std140 Camera block");
+
+/*! @brief Uniform buffer holding one T at a fixed binding point.
+ *
+ *	update() is meant to be called once per frame: it re-specifies the
+ *	storage (so the driver never waits on draws still reading last
+ *	frame's data) and binds it, after that every program with the block
+ *	reads it without any per program uniform calls.
+ */
+template<typename T>
+class UniformBuffer
+{
+public:
+	explicit UniformBuffer(UniformBlocks::Binding binding)
+		: m_binding(binding)
+	{
+		glGenBuffers(1, &m_buffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+	}
+
+	~UniformBuffer()
+	{
+		glDeleteBuffers(1, &m_buffer);
+	}
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+	// Upload and bind, once per frame
+	void update(const T& data)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(T), &data, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_buffer);
+	}
+
+	GLuint id() const { return m_buffer; }
+
+private:
+	GLuint m_buffer = 0;
+	UniformBlocks::Binding m_binding;
+};
+
+typedef UniformBuffer<CameraData> CameraBuffer;
+
+#endif // !UNIFORM_BUFFER_H
@@ -0,0 +1,25 @@
+// bone matrices of the character being drawn, see BonePaletteBuffer::bind() / UniformBlocks::BONE_PALETTE
+// #define BONE_PALETTE_SSBO before including for a BonePaletteBuffer on GL_SHADER_STORAGE_BUFFER (#version 430),
+// it has no size limit. the uniform block is the default
+#ifdef BONE_PALETTE_SSBO
+
+// storage binding 1 = UniformBlocks::BONE_PALETTE, IndirectRenderer's draws are on 0
+layout (std430, binding = 1) readonly buffer BonePalette
+{
+	mat4 finalBonesMatrices[];
+};
+
+#else
+
+// #define MAX_BONES as the model's bone count (Animation::GetBoneCount()) before including, the range bound is that big.
+// there is no default: a block bigger than the bound range is undefined and drivers reject the draw
+#ifndef MAX_BONES
+#error define MAX_BONES as the bone count of the model before including bone_palette.glsl
+#endif
+
+layout (std140) uniform BonePalette
+{
+	mat4 finalBonesMatrices[MAX_BONES];
+};
+
+#endif
@@ -0,0 +1,9 @@
+// per frame camera data, filled once per frame by CameraBuffer (UniformBlocks::CAMERA)
+// keep in sync with CameraData in UniformBuffer.h
+layout (std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	mat4 viewProjection;
+	vec4 position;
+} camera;
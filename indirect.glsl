@@ -0,0 +1,26 @@
+// per draw data of IndirectRenderer (learnopengl/indirect_renderer.h), needs #version 430
+// keep in sync with IndirectDrawData and IndirectRenderer::DRAW_BINDING / DRAW_ID_LOCATION
+struct DrawData
+{
+	mat4 model;
+	vec4 positionScale;		// dequantization of a packed mesh (xyz), 1 and 0 for float meshes
+	vec4 positionOffset;
+	uint material;	// index of the mesh's texture set
+};
+
+layout (std430, binding = 0) readonly buffer Draws
+{
+	DrawData draws[];
+};
+
+// baseInstance of the command + the instance, see IndirectRenderer
+layout (location = 7) in uint aDrawID;
+
+#define DRAW draws[aDrawID]
+
+// object space position of the draw's vertex from its stored one: quantizedPosition() for packed meshes,
+// the position as it is for float ones
+vec3 drawPosition(vec3 stored)
+{
+	return stored * DRAW.positionScale.xyz + DRAW.positionOffset.xyz;
+}
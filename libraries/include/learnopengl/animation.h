@@ -1,20 +1,28 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
 #include <map>
 #include <glm/glm.hpp>
 #include <assimp/scene.h>
 #include <learnopengl/bone.h>
 #include <functional>
+#include <string>
+#include <utility>
 #include <learnopengl/animdata.h>
 #include <learnopengl/model_animation.h>
 
-struct AssimpNodeData
+/* The node hierarchy of an animation, flattened depth first: a node's parent always
+   comes before it, so the global pose is one forward loop over the arrays */
+struct NodeHierarchy
 {
-	glm::mat4 transformation;
-	std::string name;
-	int childrenCount;
-	std::vector<AssimpNodeData> children;
+	std::vector<glm::mat4> transforms;	// local transform of each node, when it isn't animated
+	std::vector<int> parents;			// index of each node's parent, -1 for the root
+	std::vector<size_t> nameHashes;		// HashName of each node's name
+
+	size_t size() const { return parents.size(); }
+
+	static size_t HashName(const std::string& name) { return std::hash<std::string>()(name); }
 };
 
 class Animation
@@ -32,8 +40,20 @@ public:
 		m_TicksPerSecond = animation->mTicksPerSecond;
 		aiMatrix4x4 globalTransformation = scene->mRootNode->mTransformation;
 		globalTransformation = globalTransformation.Inverse();
-		ReadHeirarchyData(m_RootNode, scene->mRootNode);
+		ReadHierarchy(scene->mRootNode);
 		SetupBones(animation, *model);
+		m_BoneCount = model->GetBoneCount();
+	}
+
+	/* An animation built in memory instead of read from a file, for procedural clips and
+	   benchmarks. boneInfoMap takes the place of the model's offset map */
+	Animation(NodeHierarchy hierarchy, std::vector<Bone> bones, std::map<std::string, BoneInfo> boneInfoMap,
+		float duration, int ticksPerSecond)
+		: m_Duration(duration), m_TicksPerSecond(ticksPerSecond), m_Bones(std::move(bones)),
+		m_Hierarchy(std::move(hierarchy)), m_BoneInfoMap(std::move(boneInfoMap))
+	{
+		for (const auto& boneInfo : m_BoneInfoMap)
+			m_BoneCount = std::max(m_BoneCount, boneInfo.second.id + 1);
 	}
 
 	~Animation()
@@ -53,10 +73,14 @@ public:
 	}
 
 	
-	inline float GetTicksPerSecond() { return m_TicksPerSecond; }
-	inline float GetDuration() { return m_Duration;}
-	inline const AssimpNodeData& GetRootNode() { return m_RootNode; }
-	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() 
+	inline const std::vector<Bone>& GetBones() const { return m_Bones; }
+
+	inline float GetTicksPerSecond() const { return m_TicksPerSecond; }
+	inline float GetDuration() const { return m_Duration;}
+	inline const NodeHierarchy& GetHierarchy() const { return m_Hierarchy; }
+	/* Bone ids of the model, the size of a pose's palette */
+	inline int GetBoneCount() const { return m_BoneCount; }
+	inline const std::map<std::string,BoneInfo>& GetBoneIDMap() const
 	{ 
 		return m_BoneInfoMap;
 	}
@@ -86,25 +110,34 @@ private:
 		m_BoneInfoMap = boneInfoMap;
 	}
 
-	void ReadHeirarchyData(AssimpNodeData& dest, const aiNode* src)
+	void ReadHierarchy(const aiNode* root)
 	{
-		assert(src);
-
-		dest.name = src->mName.data;
-		dest.transformation = AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation);
-		dest.childrenCount = src->mNumChildren;
+		assert(root);
 
-		for (int i = 0; i < src->mNumChildren; i++)
+		/* depth first with an explicit stack of (node, parent index) */
+		std::vector<std::pair<const aiNode*, int>> stack;
+		stack.push_back({ root, -1 });
+		while (!stack.empty())
 		{
-			AssimpNodeData newData;
-			ReadHeirarchyData(newData, src->mChildren[i]);
-			dest.children.push_back(newData);
+			const aiNode* src = stack.back().first;
+			const int parent = stack.back().second;
+			stack.pop_back();
+
+			const int index = (int)m_Hierarchy.size();
+			m_Hierarchy.transforms.push_back(AssimpGLMHelpers::ConvertMatrixToGLMFormat(src->mTransformation));
+			m_Hierarchy.parents.push_back(parent);
+			m_Hierarchy.nameHashes.push_back(NodeHierarchy::HashName(src->mName.data));
+
+			/* reversed, so the first child comes off the stack first */
+			for (int i = (int)src->mNumChildren - 1; i >= 0; i--)
+				stack.push_back({ src->mChildren[i], index });
 		}
 	}
 	float m_Duration;
 	int m_TicksPerSecond;
 	std::vector<Bone> m_Bones;
-	AssimpNodeData m_RootNode;
+	NodeHierarchy m_Hierarchy;
 	std::map<std::string, BoneInfo> m_BoneInfoMap;
+	int m_BoneCount = 0;
 };
 
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cassert>
+#include <vector>
+#include <learnopengl/animation.h>
+#include <learnopengl/animator.h>
+#include <learnopengl/job_system.h>
+
+/* Animates a crowd: owns one Animator per character and updates them all at once, spread
+   over a JobSystem. Every character's pose goes into one contiguous palette, allocated
+   when the character is added, so Update allocates nothing and the whole crowd can be
+   uploaded in one go. The animations must outlive the system */
+class AnimationSystem
+{
+public:
+	/* characters per job: enough work to be worth a steal, small enough to even out */
+	static const size_t GRAIN = 16;
+
+	/* threads counts the calling one, 0 uses every hardware thread. Each character's
+	   palette starts on a multiple of alignment matrices, BonePaletteBuffer::alignment()
+	   when they are bound one range at a time */
+	explicit AnimationSystem(unsigned int threads = 0, size_t alignment = 1)
+		: m_Jobs(threads), m_Alignment(std::max<size_t>(alignment, 1))
+	{
+	}
+
+	/* Room for characters and their palette matrices, so adding them doesn't reallocate */
+	void Reserve(size_t characters, size_t matrices)
+	{
+		m_Animators.reserve(characters);
+		m_Offsets.reserve(characters);
+		m_Sizes.reserve(characters);
+		m_Palette.reserve(matrices);
+	}
+
+	/* Adds a character playing the animation from its start, returns its index. Moves the
+	   palette when it has to grow, pointers from GetPalette don't survive it */
+	size_t Add(Animation* animation)
+	{
+		m_Animators.emplace_back(animation);
+		const size_t offset = (m_Palette.size() + m_Alignment - 1) / m_Alignment * m_Alignment;
+		m_Offsets.push_back(offset);
+		m_Sizes.push_back(m_Animators.back().GetPaletteSize());
+		m_Palette.resize(offset + m_Sizes.back(), glm::mat4(1.0f));
+		return m_Animators.size() - 1;
+	}
+
+	/* Advances every character by dt seconds */
+	void Update(float dt)
+	{
+		Update(dt, m_Palette.data());
+	}
+
+	/* Same, writing the crowd's poses into palette, GetPalettes().size() matrices laid out
+	   the same way, e.g. BonePaletteBuffer::map(). GetPalette is left as it was */
+	void Update(float dt, glm::mat4* palette)
+	{
+		m_Jobs.parallelFor(m_Animators.size(), GRAIN, [this, dt, palette](size_t begin, size_t end, unsigned int)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					// the slot was sized for the animation the character was added with
+					assert(m_Animators[i].GetPaletteSize() <= m_Sizes[i]);
+					m_Animators[i].UpdateAnimation(dt, palette + m_Offsets[i]);
+				}
+			});
+	}
+
+	/* The character's animator, to change what it plays: animations of the same model
+	   only, its palette slot doesn't grow. Its own GetPoseTransforms isn't updated by the
+	   system, read GetPalette instead */
+	Animator& GetAnimator(size_t character) { return m_Animators[character]; }
+
+	/* The character's pose, GetPaletteSize(character) matrices */
+	const glm::mat4* GetPalette(size_t character) const { return m_Palette.data() + m_Offsets[character]; }
+	size_t GetPaletteSize(size_t character) const { return m_Sizes[character]; }
+	size_t GetPaletteOffset(size_t character) const { return m_Offsets[character]; }
+
+	/* Every character's pose, character i starts at GetPaletteOffset(i) */
+	const std::vector<glm::mat4>& GetPalettes() const { return m_Palette; }
+
+	size_t GetCount() const { return m_Animators.size(); }
+	unsigned int GetThreadCount() const { return m_Jobs.size(); }
+
+private:
+	JobSystem m_Jobs;
+	std::vector<Animator> m_Animators;
+	size_t m_Alignment;
+	std::vector<size_t> m_Offsets;			// first palette matrix of each character
+	std::vector<size_t> m_Sizes;			// palette matrices of each character
+	std::vector<glm::mat4> m_Palette;
+};
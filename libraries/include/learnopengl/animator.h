@@ -2,77 +2,177 @@
 
 #include <glm/glm.hpp>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <assimp/scene.h>
 #include <assimp/Importer.hpp>
 #include <learnopengl/animation.h>
 #include <learnopengl/bone.h>
 
+/* A read only view of a pose's bone matrices, indexed by bone id. Valid until the
+   animator plays another animation */
+struct BonePalette
+{
+	const glm::mat4* matrices;
+	size_t count;
+
+	const glm::mat4* data() const { return matrices; }
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const glm::mat4& operator[](size_t i) const { return matrices[i]; }
+	const glm::mat4* begin() const { return matrices; }
+	const glm::mat4* end() const { return matrices + count; }
+};
+
 class Animator
 {	
 public:
-	Animator::Animator(Animation* current)
+	Animator(Animation* current)
 	{
 		m_CurrentAnimation = current;
 		m_CurrentTime = 0.0;
-		m_Transforms.reserve(100);
-		for (int i = 0; i < 100; i++)
-			m_Transforms.push_back(glm::mat4(1.0f));
+		Bind();
+	}
+
+	void UpdateAnimation(float dt)
+	{
+		UpdateAnimation(dt, m_Transforms.data());
 	}
 
-	void Animator::UpdateAnimation(float dt)
+	/* Same, writing the pose into palette instead of the animator's own: all of its
+	   GetPaletteSize() matrices, so it can point straight into a mapped buffer */
+	void UpdateAnimation(float dt, glm::mat4* palette)
 	{
 		m_DeltaTime = dt;
 		if (m_CurrentAnimation)
 		{
 			m_CurrentTime += m_CurrentAnimation->GetTicksPerSecond() * dt;
 			m_CurrentTime = fmod(m_CurrentTime, m_CurrentAnimation->GetDuration());
-			CalculateBoneTransform(&m_CurrentAnimation->GetRootNode(), glm::mat4(1.0f));
+			CalculateBoneTransforms(palette);
 		}
 	}
 
-	void Animator::PlayAnimation(Animation* pAnimation)
+	void PlayAnimation(Animation* pAnimation)
 	{
 		m_CurrentAnimation = pAnimation;
 		m_CurrentTime = 0.0f;
+		Bind();
 	}
 
-	void Animator::CalculateBoneTransform(const AssimpNodeData* node, glm::mat4 parentTransform)
+	/* Poses every node at the current time: samples the animated nodes, then one forward
+	   loop over the hierarchy for the global transforms, then the palette. Allocates nothing */
+	void CalculateBoneTransforms()
 	{
-		std::string nodeName = node->name;
-		glm::mat4 nodeTransform = node->transformation;
-
-		Bone* Bone = m_CurrentAnimation->FindBone(nodeName);
+		CalculateBoneTransforms(m_Transforms.data());
+	}
 
-		if (Bone)
+	void CalculateBoneTransforms(glm::mat4* palette)
+	{
+		const std::vector<Bone>& bones = m_CurrentAnimation->GetBones();
+		for (size_t i = 0; i < m_AnimatedNodes.size(); i++)
 		{
-			Bone->Update(m_CurrentTime);
-			nodeTransform = Bone->GetLocalTransform();
+			const int track = m_AnimatedTracks[i];
+			m_LocalTransforms[m_AnimatedNodes[i]] = bones[track].Sample(m_CurrentTime, m_Cursors[track]);
 		}
 
-		glm::mat4 globalTransformation = parentTransform * nodeTransform;
-
-		auto boneInfoMap = m_CurrentAnimation->GetBoneIDMap();
-		if (boneInfoMap.find(nodeName) != boneInfoMap.end())
-		{
-			int index = boneInfoMap[nodeName].id;
-			glm::mat4 offset = boneInfoMap[nodeName].offset;
-			m_Transforms[index] = globalTransformation * offset;
-		}
+		/* node 0 is the root, everything after it has a parent that is already done */
+		const size_t count = m_LocalTransforms.size();
+		const int* parents = m_CurrentAnimation->GetHierarchy().parents.data();
+		const glm::mat4* local = m_LocalTransforms.data();
+		glm::mat4* global = m_GlobalTransforms.data();
+		if (count > 0)
+			global[0] = local[0];
+		for (size_t i = 1; i < count; i++)
+			global[i] = global[parents[i]] * local[i];
 
-		for (int i = 0; i < node->childrenCount; i++)
-			CalculateBoneTransform(&node->children[i], globalTransformation);
+		for (int id : m_UnusedIDs)
+			palette[id] = glm::mat4(1.0f);
+		for (size_t i = 0; i < m_SkinnedNodes.size(); i++)
+			palette[m_SkinnedIDs[i]] = global[m_SkinnedNodes[i]] * m_SkinnedOffsets[i];
 	}
 
-	std::vector<glm::mat4> GetPoseTransforms() 
-	{ 
-		return m_Transforms;  
+	/* The pose of the last update, one matrix per bone of the model */
+	BonePalette GetPoseTransforms() const
+	{
+		return { m_Transforms.data(), m_Transforms.size() };
 	}
+
+	size_t GetPaletteSize() const { return m_Transforms.size(); }
 	
 private:
 	std::vector<glm::mat4> m_Transforms;
 	Animation* m_CurrentAnimation;
 	float m_CurrentTime;
 	float m_DeltaTime;
-	
-};
\ No newline at end of file
+
+	/* bound to the current animation's hierarchy by Bind(), indexed by node */
+	std::vector<glm::mat4> m_LocalTransforms;	// rest transforms, animated ones overwritten every frame
+	std::vector<glm::mat4> m_GlobalTransforms;
+	/* animated nodes and the Bone track of each */
+	std::vector<int> m_AnimatedNodes;
+	std::vector<int> m_AnimatedTracks;
+	/* nodes vertices follow, their palette slot and offset */
+	std::vector<int> m_SkinnedNodes;
+	std::vector<int> m_SkinnedIDs;
+	std::vector<glm::mat4> m_SkinnedOffsets;
+	std::vector<int> m_UnusedIDs;				// palette slots no node fills, left at identity
+	std::vector<BoneCursor> m_Cursors;			// per track, where this animator's playback is
+
+	/* Matches the current animation's nodes with its Bone tracks and palette slots, by name
+	   hash, once, instead of every frame */
+	void Bind()
+	{
+		m_LocalTransforms.clear();
+		m_GlobalTransforms.clear();
+		m_AnimatedNodes.clear();
+		m_AnimatedTracks.clear();
+		m_SkinnedNodes.clear();
+		m_SkinnedIDs.clear();
+		m_SkinnedOffsets.clear();
+		m_UnusedIDs.clear();
+		m_Cursors.clear();
+		m_Transforms.assign(m_CurrentAnimation ? m_CurrentAnimation->GetBoneCount() : 0, glm::mat4(1.0f));
+		if (!m_CurrentAnimation)
+			return;
+
+		const NodeHierarchy& hierarchy = m_CurrentAnimation->GetHierarchy();
+		const std::vector<Bone>& bones = m_CurrentAnimation->GetBones();
+		m_LocalTransforms = hierarchy.transforms;
+		m_GlobalTransforms.resize(hierarchy.size(), glm::mat4(1.0f));
+		m_Cursors.resize(bones.size());
+
+		/* the first track of a name wins, like FindBone */
+		std::unordered_map<size_t, int> tracks;
+		for (int i = (int)bones.size() - 1; i >= 0; i--)
+			tracks[NodeHierarchy::HashName(bones[i].GetBoneName())] = i;
+		std::unordered_map<size_t, const BoneInfo*> boneInfos;
+		for (const auto& boneInfo : m_CurrentAnimation->GetBoneIDMap())
+			boneInfos[NodeHierarchy::HashName(boneInfo.first)] = &boneInfo.second;
+
+		for (int node = 0; node < (int)hierarchy.size(); node++)
+		{
+			const size_t hash = hierarchy.nameHashes[node];
+			auto track = tracks.find(hash);
+			if (track != tracks.end())
+			{
+				m_AnimatedNodes.push_back(node);
+				m_AnimatedTracks.push_back(track->second);
+			}
+			auto boneInfo = boneInfos.find(hash);
+			// ids past the palette have nowhere to go
+			if (boneInfo != boneInfos.end() && boneInfo->second->id < (int)m_Transforms.size())
+			{
+				m_SkinnedNodes.push_back(node);
+				m_SkinnedIDs.push_back(boneInfo->second->id);
+				m_SkinnedOffsets.push_back(boneInfo->second->offset);
+			}
+		}
+
+		std::vector<bool> used(m_Transforms.size(), false);
+		for (int id : m_SkinnedIDs)
+			used[id] = true;
+		for (int id = 0; id < (int)used.size(); id++)
+			if (!used[id])
+				m_UnusedIDs.push_back(id);
+	}
+};
@@ -1,6 +1,6 @@
 #pragma once
 
-#include<assimp/Quaternion.h>
+#include<assimp/quaternion.h>
 #include<assimp/vector3.h>
 #include<assimp/matrix4x4.h>
 #include<glm/glm.hpp>
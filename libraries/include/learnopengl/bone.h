@@ -2,6 +2,9 @@
 
 /* Container for bone data */
 
+#include <algorithm>
+#include <cassert>
+#include <string>
 #include <vector>
 #include <assimp/scene.h>
 #include <list>
@@ -28,6 +31,15 @@ struct KeyScale
 	float timeStamp;
 };
 
+/* Where the last lookup in each of a bone's tracks ended. Playing forward, the next
+   key is almost always in the same segment or the one after, so lookups start there */
+struct BoneCursor
+{
+	int position = 0;
+	int rotation = 0;
+	int scale = 0;
+};
+
 class Bone
 {
 public:
@@ -74,10 +86,17 @@ public:
 	
 	void Update(float animationTime)
 	{
-		glm::mat4 translation = InterpolatePosition(animationTime);
-		glm::mat4 rotation = InterpolateRotation(animationTime);
-		glm::mat4 scale = InterpolateScaling(animationTime);
-		m_LocalTransform = translation * rotation * scale;
+		m_LocalTransform = Sample(animationTime, m_Cursor);
+	}
+
+	/* The local transform at animationTime, with the caller's own cursor. Leaves the bone
+	   untouched, so several animators can sample it at once */
+	glm::mat4 Sample(float animationTime, BoneCursor& cursor) const
+	{
+		glm::mat4 translation = InterpolatePosition(animationTime, cursor.position);
+		glm::mat4 rotation = InterpolateRotation(animationTime, cursor.rotation);
+		glm::mat4 scale = InterpolateScaling(animationTime, cursor.scale);
+		return translation * rotation * scale;
 	}
 	glm::mat4 GetLocalTransform() { return m_LocalTransform; }
 	std::string GetBoneName() const { return m_Name; }
@@ -87,52 +106,74 @@ public:
 
 	int GetPositionIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumPositions - 1; ++index)
-		{
-			if (animationTime < m_Positions[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		return FindKey(m_Positions, animationTime, m_Cursor.position);
 	}
 
 	int GetRotationIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumRotations - 1; ++index)
-		{
-			if (animationTime < m_Rotations[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		return FindKey(m_Rotations, animationTime, m_Cursor.rotation);
 	}
 
 	int GetScaleIndex(float animationTime)
 	{
-		for (int index = 0; index < m_NumScalings - 1; ++index)
-		{
-			if (animationTime < m_Scales[index + 1].timeStamp)
-				return index;
-		}
-		assert(0);
+		return FindKey(m_Scales, animationTime, m_Cursor.scale);
 	}
 
 
 private:
 
-	float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+	/* Index of the key that starts the segment animationTime lies in, clamped to the
+	   first and last segment. Tries the cursor's segment and the next one, then falls
+	   back to a binary search (seeks, loops). Tracks need at least two keys */
+	template <typename Key>
+	static int FindKey(const std::vector<Key>& keys, float animationTime, int& cursor)
+	{
+		const int last = (int)keys.size() - 2;
+		int index = std::min(std::max(cursor, 0), last);
+		if (animationTime >= keys[index].timeStamp)
+		{
+			if (index < last && animationTime >= keys[index + 1].timeStamp)
+			{
+				index++;
+				if (index < last && animationTime >= keys[index + 1].timeStamp)
+					index = Search(keys, animationTime, index + 1, last);
+			}
+		}
+		else
+			index = Search(keys, animationTime, 0, index);
+		cursor = index;
+		return index;
+	}
+
+	/* Last key in [first, last] starting at or before animationTime, first if none does */
+	template <typename Key>
+	static int Search(const std::vector<Key>& keys, float animationTime, int first, int last)
+	{
+		auto begin = keys.begin() + first;
+		auto end = keys.begin() + last + 1;
+		auto next = std::upper_bound(begin, end, animationTime,
+			[](float time, const Key& key) { return time < key.timeStamp; });
+		return next == begin ? first : (int)(next - keys.begin()) - 1;
+	}
+
+	/* How far animationTime is between the two keys, clamped to [0, 1]: times before the
+	   first key hold it, times past the last key hold that one. Keys on the same time
+	   stamp jump to the later one */
+	static float GetScaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
 	{
-		float scaleFactor = 0.0f;
-		float midWayLength = animationTime - lastTimeStamp;
 		float framesDiff = nextTimeStamp - lastTimeStamp;
-		scaleFactor = midWayLength / framesDiff;
-		return scaleFactor;
+		if (framesDiff <= 0.0f)
+			return animationTime < lastTimeStamp ? 0.0f : 1.0f;
+		float midWayLength = animationTime - lastTimeStamp;
+		return glm::clamp(midWayLength / framesDiff, 0.0f, 1.0f);
 	}
 
-	glm::mat4 InterpolatePosition(float animationTime)
+	glm::mat4 InterpolatePosition(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumPositions)
 			return glm::translate(glm::mat4(1.0f), m_Positions[0].position);
 
-		int p0Index = GetPositionIndex(animationTime);
+		int p0Index = FindKey(m_Positions, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Positions[p0Index].timeStamp,
 			m_Positions[p1Index].timeStamp, animationTime);
@@ -141,7 +182,7 @@ private:
 		return glm::translate(glm::mat4(1.0f), finalPosition);
 	}
 
-	glm::mat4 InterpolateRotation(float animationTime)
+	glm::mat4 InterpolateRotation(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumRotations)
 		{
@@ -149,7 +190,7 @@ private:
 			return glm::toMat4(rotation);
 		}
 
-		int p0Index = GetRotationIndex(animationTime);
+		int p0Index = FindKey(m_Rotations, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Rotations[p0Index].timeStamp,
 			m_Rotations[p1Index].timeStamp, animationTime);
@@ -160,12 +201,12 @@ private:
 
 	}
 
-	glm::mat4 Bone::InterpolateScaling(float animationTime)
+	glm::mat4 InterpolateScaling(float animationTime, int& cursor) const
 	{
 		if (1 == m_NumScalings)
 			return glm::scale(glm::mat4(1.0f), m_Scales[0].scale);
 
-		int p0Index = GetScaleIndex(animationTime);
+		int p0Index = FindKey(m_Scales, animationTime, cursor);
 		int p1Index = p0Index + 1;
 		float scaleFactor = GetScaleFactor(m_Scales[p0Index].timeStamp,
 			m_Scales[p1Index].timeStamp, animationTime);
@@ -182,6 +223,7 @@ private:
 	int m_NumScalings;
 
 	glm::mat4 m_LocalTransform;
+	BoneCursor m_Cursor;
 	std::string m_Name;
 	int m_ID;
 };
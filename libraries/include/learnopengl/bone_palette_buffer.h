@@ -0,0 +1,147 @@
+#ifndef BONE_PALETTE_BUFFER_H
+#define BONE_PALETTE_BUFFER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/gl_extensions.h>
+
+#include <algorithm>
+#include <vector>
+using namespace std;
+
+// Bone matrix palettes for skinning, in a uniform or shader storage buffer split in SEGMENTS frames. map() hands
+// out the frame's palettes to write the poses into, AnimationSystem::Update and Animator::UpdateAnimation take
+// the pointer, bind() points the shader's block (bone_palette.glsl) at one character's palette before its draw,
+// and fence() goes after the last draw of the frame. a segment is only written again once the GPU is done with
+// the draws that read it.
+//
+// with GL 4.4 / ARB_buffer_storage the buffer stays mapped and the poses are written straight into it. without
+// it map() returns a staging array that unmap() uploads with glBufferSubData.
+class BonePaletteBuffer
+{
+public:
+    static const unsigned int SEGMENTS = 3;    // frames the GPU may still be reading palettes from
+
+    // capacity is the matrices written per frame, AnimationSystem::GetPalettes().size() for a crowd. target is
+    // GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER (shaders define BONE_PALETTE_SSBO before bone_palette.glsl).
+    // needs loadGLExtensions() for the mapped buffer
+    explicit BonePaletteBuffer(size_t capacity, GLenum target = GL_UNIFORM_BUFFER)
+        : target(target), matrices(std::max<size_t>(capacity, 1))
+    {
+        GLint offsetAlignment = 0;
+        glGetIntegerv(target == GL_SHADER_STORAGE_BUFFER ? GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT : GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+        // the GL's alignments are powers of two, a whole number of matrices covers any of them
+        alignmentMatrices = std::max<size_t>(1, ((size_t)offsetAlignment + sizeof(glm::mat4) - 1) / sizeof(glm::mat4));
+        const size_t aligned = (matrices + alignmentMatrices - 1) / alignmentMatrices * alignmentMatrices;
+        segmentBytes = aligned * sizeof(glm::mat4);
+
+        glGenBuffers(1, &buffer);
+        glBindBuffer(target, buffer);
+        if (glext().ARB_buffer_storage)
+        {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glext().BufferStorage(target, (GLsizeiptr)(segmentBytes * SEGMENTS), NULL, flags);
+            mapped = (glm::mat4*)glMapBufferRange(target, 0, (GLsizeiptr)(segmentBytes * SEGMENTS), flags);
+        }
+        if (!mapped)
+        {
+            // a buffer made with glBufferStorage can't be respecified, start over with a mutable one
+            glBindBuffer(target, 0);
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(target, buffer);
+            glBufferData(target, (GLsizeiptr)(segmentBytes * SEGMENTS), NULL, GL_DYNAMIC_DRAW);
+            staging.resize(matrices, glm::mat4(1.0f));
+        }
+        glBindBuffer(target, 0);
+    }
+
+    ~BonePaletteBuffer()
+    {
+        for (GLsync fence : fences)
+            if (fence)
+                glDeleteSync(fence);
+        if (mapped)
+        {
+            glBindBuffer(target, buffer);
+            glUnmapBuffer(target);
+            glBindBuffer(target, 0);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+
+    BonePaletteBuffer(const BonePaletteBuffer&) = delete;
+    BonePaletteBuffer& operator=(const BonePaletteBuffer&) = delete;
+
+    // the frame's capacity() matrices to write palettes into, waits if the GPU still reads this segment
+    glm::mat4 *map()
+    {
+        if (!mapped)
+            return staging.data();
+        if (fences[segment])
+        {
+            // normally signalled long ago, SEGMENTS frames back
+            while (glClientWaitSync(fences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+                ;
+            glDeleteSync(fences[segment]);
+            fences[segment] = 0;
+        }
+        return (glm::mat4*)((unsigned char*)mapped + segment * segmentBytes);
+    }
+
+    // done writing the first count matrices of map(), uploads them unless the buffer is mapped
+    void unmap(size_t count)
+    {
+        if (mapped || count == 0)
+            return;
+        glBindBuffer(target, buffer);
+        glBufferSubData(target, (GLintptr)(segment * segmentBytes), (GLsizeiptr)(std::min(count, matrices) * sizeof(glm::mat4)), staging.data());
+        glBindBuffer(target, 0);
+    }
+
+    // binds count matrices of this frame's palettes, from first on, to the block at binding. first has to be a
+    // multiple of alignment(), which AnimationSystem lays characters out on when constructed with it. a uniform
+    // block has to be no bigger than count: the shader's MAX_BONES is the character's palette size
+    void bind(GLuint binding, size_t first, size_t count) const
+    {
+        glBindBufferRange(target, binding, buffer, (GLintptr)(segment * segmentBytes + first * sizeof(glm::mat4)), (GLsizeiptr)(count * sizeof(glm::mat4)));
+    }
+
+    // after the frame's last draw reading the palettes, the next map() moves to the next segment
+    void fence()
+    {
+        if (mapped)
+        {
+            if (fences[segment])
+                glDeleteSync(fences[segment]);
+            fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        segment = (segment + 1) % SEGMENTS;
+    }
+
+    // offset alignment of bind(), in matrices
+    size_t alignment() const { return alignmentMatrices; }
+
+    // matrices map() has room for
+    size_t capacity() const { return matrices; }
+
+    // true if the poses are written straight into the buffer
+    bool persistentlyMapped() const { return mapped != nullptr; }
+
+    GLuint id() const { return buffer; }
+
+private:
+    GLenum            target;
+    size_t            matrices;
+    size_t            alignmentMatrices = 1;
+    size_t            segmentBytes = 0;
+
+    GLuint            buffer = 0;
+    glm::mat4        *mapped = nullptr;
+    vector<glm::mat4> staging;
+    GLsync            fences[SEGMENTS] = {};
+    unsigned int      segment = 0;
+};
+#endif
@@ -0,0 +1,169 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/camera.h>
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
+using namespace std;
+
+// the six planes of a view volume, facing inwards: a point p is on the inner side of a plane when
+// dot(plane.xyz, p) + plane.w >= 0. the normals have unit length, so that is also the distance to the plane
+struct Frustum {
+    glm::vec4 planes[6];    // left, right, bottom, top, near, far
+
+    Frustum()
+    {
+        for (glm::vec4 &plane : planes)
+            plane = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    // planes of a view-projection matrix (Gribb & Hartmann), in the space the matrix maps from:
+    // world space for projection * view
+    explicit Frustum(const glm::mat4 &viewProjection)
+    {
+        // glm is column major, these are the matrix's rows
+        const glm::mat4 rows = glm::transpose(viewProjection);
+        planes[0] = rows[3] + rows[0];
+        planes[1] = rows[3] - rows[0];
+        planes[2] = rows[3] + rows[1];
+        planes[3] = rows[3] - rows[1];
+        planes[4] = rows[3] + rows[2];
+        planes[5] = rows[3] - rows[2];
+        for (glm::vec4 &plane : planes)
+            plane /= glm::length(glm::vec3(plane));
+    }
+
+    // the frustum the camera sees through a perspective projection set up from its zoom, like the samples do
+    static Frustum of(const Camera &camera, float aspect, float nearPlane, float farPlane)
+    {
+        return Frustum(glm::perspective(glm::radians(camera.Zoom), aspect, nearPlane, farPlane) * camera.GetViewMatrix());
+    }
+
+    // true unless the sphere lies entirely outside of one of the planes
+    bool intersects(const glm::vec3 &center, float radius) const
+    {
+        for (const glm::vec4 &plane : planes)
+            if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                return false;
+        return true;
+    }
+};
+
+// meshes handed to a culling pass and the ones it dropped
+struct CullingStats {
+    size_t tested = 0;
+    size_t culled = 0;
+
+    size_t submitted() const { return tested - culled; }
+    void reset() { tested = culled = 0; }
+};
+
+// Bounding spheres in world space, tested against a frustum all at once.
+//
+// the spheres are kept as a structure of arrays and tested BATCH at a time: the loop over a batch is the same
+// float math for every lane with no branches, which compilers turn into SSE/AVX/NEON code on their own.
+// a sphere's result is the smallest signed distance to any plane plus its radius, negative means culled.
+class FrustumCuller {
+public:
+    static const size_t BATCH = 8;
+
+    void clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+        radius.clear();
+        inside.clear();
+    }
+
+    // adds a sphere, its index is the number of spheres added before it
+    void add(const glm::vec3 &center, float sphereRadius)
+    {
+        x.push_back(center.x);
+        y.push_back(center.y);
+        z.push_back(center.z);
+        radius.push_back(sphereRadius);
+    }
+
+    // adds the mesh's bounding sphere moved by a model matrix. scale is maxScale(transform), pass it along
+    // when adding many meshes with the same matrix
+    void add(const MeshBounds &bounds, const glm::mat4 &transform, float scale)
+    {
+        add(glm::vec3(transform * glm::vec4(bounds.center, 1.0f)), bounds.radius * scale);
+    }
+
+    void add(const MeshBounds &bounds, const glm::mat4 &transform)
+    {
+        add(bounds, transform, maxScale(transform));
+    }
+
+    // how much the matrix stretches a sphere at most: its longest axis
+    static float maxScale(const glm::mat4 &transform)
+    {
+        return std::sqrt(std::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+                         std::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])),
+                                  glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2])))));
+    }
+
+    size_t size() const { return x.size(); }
+
+    // tests every sphere added since clear(), visible() has the results
+    void cull(const Frustum &frustum)
+    {
+        const size_t count = x.size();
+        // whole batches only, the padding lanes are computed and ignored
+        const size_t padded = (count + BATCH - 1) / BATCH * BATCH;
+        x.resize(padded, 0.0f);
+        y.resize(padded, 0.0f);
+        z.resize(padded, 0.0f);
+        radius.resize(padded, 0.0f);
+        inside.resize(padded);
+
+        stats.tested = count;
+        stats.culled = 0;
+        for (size_t first = 0; first < padded; first += BATCH)
+        {
+            float nearest[BATCH];
+            for (size_t lane = 0; lane < BATCH; lane++)
+                nearest[lane] = std::numeric_limits<float>::infinity();
+            for (const glm::vec4 &plane : frustum.planes)
+            {
+                for (size_t lane = 0; lane < BATCH; lane++)
+                {
+                    const float d = plane.x * x[first + lane] + plane.y * y[first + lane] + plane.z * z[first + lane] + plane.w;
+                    nearest[lane] = std::min(nearest[lane], d);
+                }
+            }
+            for (size_t lane = 0; lane < BATCH; lane++)
+                inside[first + lane] = nearest[lane] + radius[first + lane] >= 0.0f ? 1 : 0;
+        }
+
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        radius.resize(count);
+        inside.resize(count);
+        for (size_t i = 0; i < count; i++)
+            stats.culled += inside[i] ? 0 : 1;
+    }
+
+    // result of the last cull() for the i-th sphere
+    bool visible(size_t i) const { return inside[i] != 0; }
+
+    // numbers of the last cull()
+    const CullingStats &lastStats() const { return stats; }
+
+private:
+    vector<float>   x, y, z, radius;
+    vector<uint8_t> inside;
+    CullingStats    stats;
+};
+#endif
@@ -0,0 +1,137 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <cstring>
+
+// the glad loader in this tree is generated for plain GL 3.3 core. entry points from later versions or
+// extensions are resolved here at runtime instead; check the matching flag in glext() before using them.
+
+// GL_ARB_get_program_binary (core in 4.1)
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#define GL_PROGRAM_BINARY_FORMATS 0x87FF
+#endif
+typedef void (APIENTRYP PFNGLEXTGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLEXTPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLEXTPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+// GL_KHR_parallel_shader_compile / GL_ARB_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+typedef void (APIENTRYP PFNGLEXTMAXSHADERCOMPILERTHREADSPROC)(GLuint count);
+
+// GL_ARB_draw_indirect (core in 4.0) / GL_ARB_multi_draw_indirect (core in 4.3)
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP PFNGLEXTMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+// GL_ARB_shader_storage_buffer_object (core in 4.3), glBindBufferBase does the binding
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT 0x90DF
+#endif
+
+// GL_ARB_buffer_storage (core in 4.4), immutable buffers that can stay mapped while the GL reads them
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+typedef void (APIENTRYP PFNGLEXTBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+struct GLExtensions
+{
+    bool loaded = false;
+
+    // GL_ARB_get_program_binary
+    bool ARB_get_program_binary = false;
+    PFNGLEXTGETPROGRAMBINARYPROC  GetProgramBinary  = nullptr;
+    PFNGLEXTPROGRAMBINARYPROC     ProgramBinary     = nullptr;
+    PFNGLEXTPROGRAMPARAMETERIPROC ProgramParameteri = nullptr;
+
+    // GL_KHR_parallel_shader_compile (or the ARB flavour, same enums)
+    bool KHR_parallel_shader_compile = false;
+    PFNGLEXTMAXSHADERCOMPILERTHREADSPROC MaxShaderCompilerThreads = nullptr;
+
+    // GL_ARB_multi_draw_indirect, baseInstance in the commands needs GL_ARB_base_instance which 4.3 includes
+    bool ARB_multi_draw_indirect = false;
+    PFNGLEXTMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect = nullptr;
+
+    // GL_ARB_shader_storage_buffer_object
+    bool ARB_shader_storage_buffer_object = false;
+
+    // GL_ARB_buffer_storage
+    bool ARB_buffer_storage = false;
+    PFNGLEXTBUFFERSTORAGEPROC BufferStorage = nullptr;
+};
+
+// process wide table, filled by loadGLExtensions()
+inline GLExtensions& glext()
+{
+    static GLExtensions extensions;
+    return extensions;
+}
+
+// true if the context is at least the given version
+inline bool hasGLVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+// true if the current context advertises the extension
+inline bool hasGLExtension(const char* name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// resolves the entry points above. call once after gladLoadGLLoader, with the same loader, on the thread owning the context.
+inline void loadGLExtensions(GLADloadproc load)
+{
+    GLExtensions& ext = glext();
+    ext = GLExtensions();
+
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        ext.GetProgramBinary  = (PFNGLEXTGETPROGRAMBINARYPROC)load("glGetProgramBinary");
+        ext.ProgramBinary     = (PFNGLEXTPROGRAMBINARYPROC)load("glProgramBinary");
+        ext.ProgramParameteri = (PFNGLEXTPROGRAMPARAMETERIPROC)load("glProgramParameteri");
+        ext.ARB_get_program_binary = ext.GetProgramBinary && ext.ProgramBinary && ext.ProgramParameteri;
+    }
+
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLEXTMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        ext.MaxShaderCompilerThreads = (PFNGLEXTMAXSHADERCOMPILERTHREADSPROC)load("glMaxShaderCompilerThreadsARB");
+    ext.KHR_parallel_shader_compile = ext.MaxShaderCompilerThreads != nullptr;
+
+    if (hasGLVersion(4, 3) || (hasGLExtension("GL_ARB_multi_draw_indirect") && hasGLExtension("GL_ARB_base_instance")))
+        ext.MultiDrawElementsIndirect = (PFNGLEXTMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    ext.ARB_multi_draw_indirect = ext.MultiDrawElementsIndirect != nullptr;
+
+    ext.ARB_shader_storage_buffer_object = hasGLVersion(4, 3) || hasGLExtension("GL_ARB_shader_storage_buffer_object");
+
+    if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage"))
+        ext.BufferStorage = (PFNGLEXTBUFFERSTORAGEPROC)load("glBufferStorage");
+    ext.ARB_buffer_storage = ext.BufferStorage != nullptr;
+
+    ext.loaded = true;
+}
+#endif
@@ -0,0 +1,310 @@
+#ifndef INDIRECT_RENDERER_H
+#define INDIRECT_RENDERER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/frustum.h>
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/model.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <vector>
+using namespace std;
+
+// layout of glMultiDrawElementsIndirect's commands
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// one entry of the per draw storage buffer, std430. keep in sync with DrawData in indirect.glsl
+struct IndirectDrawData {
+    glm::mat4    model;
+    glm::vec4    positionScale;     // dequantization of a packed mesh's positions (xyz), 1 and 0 for float meshes
+    glm::vec4    positionOffset;
+    unsigned int material;
+    unsigned int padding[3];
+};
+static_assert(sizeof(IndirectDrawData) == 112, "IndirectDrawData has to match the std430 layout of DrawData");
+
+// Records every mesh of every submitted model instance and draws them all with glMultiDrawElementsIndirect.
+//
+// flush() sorts the draws by vertex array and material (the set of textures a mesh binds), merges instances
+// of the same mesh into one command and issues one multi-draw per run of equal vertex array and material:
+// packed models (one VAO each) sharing their textures cost a single call. transforms and material indices
+// go to a shader storage buffer, read in the vertex shader through indirect.glsl.
+//
+// shaders find their entry by the draw index, a per instance vertex attribute fed from a buffer of
+// 0, 1, 2, ... that every command offsets with its baseInstance. gl_DrawID would need GL 4.6.
+//
+// flush(shader, frustum) first drops the meshes whose bounding spheres lie outside the frustum, all submitted
+// meshes in one batched pass (FrustumCuller).
+//
+// needs GL 4.3 (or the ARB extensions), check supported() and fall back to Model::Draw without it.
+class IndirectRenderer {
+public:
+    static const GLuint DRAW_BINDING     = 0;   // shader storage binding of the per draw data
+    static const GLuint DRAW_ID_LOCATION = 7;   // vertex attribute with the draw index, after the Vertex and bone ones
+
+    static bool supported()
+    {
+        return glext().ARB_multi_draw_indirect && glext().ARB_shader_storage_buffer_object;
+    }
+
+    IndirectRenderer()
+    {
+        glGenBuffers(1, &commandBuffer);
+        glGenBuffers(1, &drawBuffer);
+        glGenBuffers(1, &drawIdBuffer);
+    }
+
+    ~IndirectRenderer()
+    {
+        glDeleteBuffers(1, &commandBuffer);
+        glDeleteBuffers(1, &drawBuffer);
+        glDeleteBuffers(1, &drawIdBuffer);
+    }
+
+    IndirectRenderer(const IndirectRenderer&) = delete;
+    IndirectRenderer& operator=(const IndirectRenderer&) = delete;
+
+    // queues every mesh of the model at its selected level of detail, drawn with the given model matrix.
+    // the model has to outlive the next flush()
+    void submit(Model &model, const glm::mat4 &transform)
+    {
+        const unsigned int transformIndex = (unsigned int)transforms.size();
+        transforms.push_back(transform);
+        const float scale = FrustumCuller::maxScale(transform);
+        for (Mesh &mesh : model.meshes)
+        {
+            // the culler's spheres line up with records
+            culler.add(mesh.bounds, transform, scale);
+            Record record;
+            record.vertexArray = mesh.VAO;
+            record.material    = material(mesh);
+            record.mesh        = &mesh;
+            record.range       = mesh.currentLod();
+            record.transform   = transformIndex;
+            records.push_back(record);
+        }
+    }
+
+    // draws everything submitted since the last flush with the shader, then forgets it
+    void flush(Shader &shader)
+    {
+        cullingStats = CullingStats();
+        cullingStats.tested = records.size();
+        draw(shader);
+    }
+
+    // the same, without the meshes outside of the frustum
+    void flush(Shader &shader, const Frustum &frustum)
+    {
+        culler.cull(frustum);
+        cullingStats = culler.lastStats();
+        size_t kept = 0;
+        for (size_t i = 0; i < records.size(); i++)
+            if (culler.visible(i))
+                records[kept++] = records[i];
+        records.resize(kept);
+        draw(shader);
+    }
+
+    // numbers of the last flush: meshes drawn, indirect commands and multi-draw calls
+    size_t drawCount() const { return lastDraws; }
+    size_t commandCount() const { return lastCommands; }
+    size_t batchCount() const { return lastBatches; }
+
+    // meshes submitted for the last flush and how many of them the frustum culled
+    const CullingStats &lastCullingStats() const { return cullingStats; }
+
+    // distinct texture sets seen so far, the material index in DrawData is one of these
+    size_t materialCount() const { return materials.size(); }
+
+private:
+    void draw(Shader &shader)
+    {
+        culler.clear();
+        if (records.empty())
+        {
+            lastDraws = lastCommands = lastBatches = 0;
+            transforms.clear();
+            return;
+        }
+
+        // same vertex array, then same material, then same mesh and level of detail next to each other
+        std::sort(records.begin(), records.end(), [](const Record &a, const Record &b) {
+            if (a.vertexArray != b.vertexArray)
+                return a.vertexArray < b.vertexArray;
+            if (a.material != b.material)
+                return a.material < b.material;
+            if (a.range.firstIndex != b.range.firstIndex)
+                return a.range.firstIndex < b.range.firstIndex;
+            return std::less<const Mesh*>()(a.mesh, b.mesh);
+        });
+
+        draws.resize(records.size());
+        commands.clear();
+        batches.clear();
+        for (size_t i = 0; i < records.size(); i++)
+        {
+            const Record &record = records[i];
+            // the dequantization stays out of the model matrix: it is a non uniform scale the packed normals and
+            // tangents never went through, a normal matrix derived from model would skew them
+            const bool packed = record.mesh->format == VERTEX_PACKED;
+            draws[i].model          = transforms[record.transform];
+            draws[i].positionScale  = glm::vec4(packed ? record.mesh->quantization.scale : glm::vec3(1.0f), 0.0f);
+            draws[i].positionOffset = glm::vec4(packed ? record.mesh->quantization.offset : glm::vec3(0.0f), 0.0f);
+            draws[i].material       = record.material;
+
+            // instances of a model can be at different levels of detail, only the same one shares a command
+            const bool sameMesh = i > 0 && records[i - 1].mesh == record.mesh && records[i - 1].range.firstIndex == record.range.firstIndex;
+            if (sameMesh)
+            {
+                // consecutive draw entries, so one instanced command covers them
+                commands.back().instanceCount++;
+                continue;
+            }
+
+            DrawElementsIndirectCommand command;
+            command.count         = record.range.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex    = record.range.firstIndex;
+            command.baseVertex    = record.mesh->baseVertex;
+            command.baseInstance  = (GLuint)i;
+            commands.push_back(command);
+
+            if (batches.empty() || batches.back().vertexArray != record.vertexArray || batches.back().material != record.material)
+            {
+                Batch batch;
+                batch.vertexArray  = record.vertexArray;
+                batch.material     = record.material;
+                batch.mesh         = record.mesh;
+                batch.firstCommand = commands.size() - 1;
+                batch.commandCount = 0;
+                batches.push_back(batch);
+            }
+            batches.back().commandCount++;
+        }
+        upload();
+
+        shader.use();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BINDING, drawBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        GLuint boundArray = 0;
+        for (const Batch &batch : batches)
+        {
+            if (batch.vertexArray != boundArray)
+            {
+                glBindVertexArray(batch.vertexArray);
+                prepareVertexArray();
+                boundArray = batch.vertexArray;
+            }
+            // every mesh of a batch binds the same textures, any of them can do it
+            batch.mesh->bindTextures(shader);
+            glext().MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                (const void*)(batch.firstCommand * sizeof(DrawElementsIndirectCommand)), (GLsizei)batch.commandCount, 0);
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+
+        lastDraws    = records.size();
+        lastCommands = commands.size();
+        lastBatches  = batches.size();
+        records.clear();
+        transforms.clear();
+    }
+
+    struct Record {
+        GLuint       vertexArray;
+        unsigned int material;
+        Mesh        *mesh;
+        MeshLod      range;     // level of detail at submit time, absolute in the index buffer
+        unsigned int transform;
+    };
+
+    struct Batch {
+        GLuint       vertexArray;
+        unsigned int material;
+        Mesh        *mesh;
+        size_t       firstCommand;
+        size_t       commandCount;
+    };
+
+    vector<Record>                      records;
+    vector<glm::mat4>                   transforms;
+    vector<IndirectDrawData>            draws;
+    vector<DrawElementsIndirectCommand> commands;
+    vector<Batch>                       batches;
+    map<vector<GLuint>, unsigned int>   materials;  // texture ids in binding order -> material index
+    FrustumCuller                       culler;     // every record's bounding sphere in world space
+    CullingStats                        cullingStats;
+
+    GLuint commandBuffer = 0, drawBuffer = 0, drawIdBuffer = 0;
+    size_t drawIdCapacity = 0;
+
+    size_t lastDraws = 0, lastCommands = 0, lastBatches = 0;
+
+    // materials are told apart by the textures they bind, so meshes sharing them can share a multi-draw
+    unsigned int material(const Mesh &mesh)
+    {
+        vector<GLuint> key;
+        key.reserve(mesh.textures.size());
+        for (const Texture &texture : mesh.textures)
+            key.push_back(texture.id);
+        auto found = materials.find(key);
+        if (found != materials.end())
+            return found->second;
+        unsigned int index = (unsigned int)materials.size();
+        materials.emplace(std::move(key), index);
+        return index;
+    }
+
+    void upload()
+    {
+        // orphaned every frame, the driver hands out fresh storage while the last frame's draws still read the old one
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(IndirectDrawData), draws.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        // the draw indices only ever grow, vertex arrays keep pointing at the same buffer name
+        if (draws.size() > drawIdCapacity)
+        {
+            drawIdCapacity = std::max(draws.size(), drawIdCapacity * 2);
+            vector<GLuint> ids(drawIdCapacity);
+            for (size_t i = 0; i < ids.size(); i++)
+                ids[i] = (GLuint)i;
+            glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+            glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), ids.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+
+    // hooks the draw index attribute into the bound vertex array, once per array.
+    // asking the array itself instead of remembering it keeps this right when a deleted array's name gets reused
+    void prepareVertexArray()
+    {
+        GLint buffer = 0;
+        glGetVertexAttribiv(DRAW_ID_LOCATION, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &buffer);
+        if ((GLuint)buffer == drawIdBuffer)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glEnableVertexAttribArray(DRAW_ID_LOCATION);
+        glVertexAttribIPointer(DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
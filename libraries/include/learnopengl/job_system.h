@@ -0,0 +1,162 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// runs the iterations of a loop on a fixed set of worker threads plus the calling one. parallelFor() cuts the
+// range into chunks dealt round robin to one deque per thread. a thread takes chunks from the back of its own
+// deque and, once it is empty, steals from the front of the others', so chunks that take longer even out.
+// unlike ThreadPool there is no future per job: parallelFor() returns once every chunk has run. like ThreadPool,
+// keep GL calls out of the loop body, and don't let it throw.
+class JobSystem
+{
+public:
+    // threads counts the calling thread, 0 picks one per hardware thread. 1 runs every loop on the caller
+    explicit JobSystem(unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+        for (unsigned int i = 0; i < threads; i++)
+            queues.emplace_back(new Queue());
+        workers.reserve(threads - 1);
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back([this, i] { run(i); });
+    }
+
+    ~JobSystem()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // calls body(begin, end, thread) over [0, count) in chunks of grain iterations, thread is the index of the
+    // thread running the chunk (0 for the caller, below size()), for per thread scratch space. not reentrant
+    template <typename F>
+    void parallelFor(size_t count, size_t grain, F&& body)
+    {
+        if (count == 0)
+            return;
+        grain = std::max<size_t>(grain, 1);
+        const size_t chunks = (count + grain - 1) / grain;
+        if (queues.size() == 1 || chunks == 1)
+        {
+            body((size_t)0, count, 0u);
+            return;
+        }
+
+        job = [&body](size_t begin, size_t end, unsigned int thread) { body(begin, end, thread); };
+        remaining.store(chunks);
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+        {
+            Queue& queue = *queues[chunk % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.chunks.emplace_back(chunk * grain, std::min(count, (chunk + 1) * grain));
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            generation++;
+        }
+        wake.notify_all();
+
+        work(0);
+        // the last chunks may still be running on the workers
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] { return remaining.load() == 0; });
+    }
+
+    // threads running a loop, the caller included
+    unsigned int size() const { return (unsigned int)queues.size(); }
+
+private:
+    struct Queue
+    {
+        std::mutex                            mutex;
+        std::deque<std::pair<size_t, size_t>> chunks;
+    };
+
+    // takes a chunk: the newest of the thread's own, else the oldest of another thread's
+    bool take(unsigned int thread, std::pair<size_t, size_t>& chunk)
+    {
+        for (size_t i = 0; i < queues.size(); i++)
+        {
+            Queue& queue = *queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.chunks.empty())
+                continue;
+            if (i == 0)
+            {
+                chunk = queue.chunks.back();
+                queue.chunks.pop_back();
+            }
+            else
+            {
+                chunk = queue.chunks.front();
+                queue.chunks.pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // runs chunks until there are none left anywhere
+    void work(unsigned int thread)
+    {
+        std::pair<size_t, size_t> chunk;
+        while (take(thread, chunk))
+        {
+            job(chunk.first, chunk.second, thread);
+            if (remaining.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.notify_all();
+            }
+        }
+    }
+
+    void run(unsigned int thread)
+    {
+        size_t seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+            work(thread);
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>>               queues;         // one per thread, the caller's first
+    std::vector<std::thread>                          workers;
+    std::function<void(size_t, size_t, unsigned int)> job;            // body of the running loop
+    std::atomic<size_t>                               remaining{ 0 }; // chunks of it not done yet
+    std::mutex                                        mutex;
+    std::condition_variable                           wake;
+    std::condition_variable                           finished;
+    size_t                                            generation = 0; // loops started
+    bool                                              stopping = false;
+};
+#endif
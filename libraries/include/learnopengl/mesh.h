@@ -5,9 +5,14 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <learnopengl/shader.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <string>
 #include <vector>
 using namespace std;
@@ -25,42 +30,506 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+#define MAX_BONE_WEIGHTS 4
+
+// the bones moving a vertex of a skinned mesh. kept out of Vertex in a second vertex buffer (Mesh::setBoneData),
+// so meshes without bones don't carry it
+struct VertexBoneData {
+    //bone indexes which will influence this vertex
+    int m_BoneIDs[MAX_BONE_WEIGHTS];
+    //weights from each bone
+    float m_Weights[MAX_BONE_WEIGHTS];
+};
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// how a mesh's vertices are stored on the GPU
+enum VertexFormat {
+    VERTEX_FLOAT,   // Vertex as it is, 56 bytes
+    VERTEX_PACKED   // PackedVertex, 20 bytes, decoded in the vertex shader with packed_vertex.glsl
+};
+
+// quantized Vertex
+struct PackedVertex {
+    int16_t  position[4];   // snorm16 of (Position - offset) / scale, w holds the sign of the bitangent
+    int16_t  normal[2];     // octahedral, snorm16
+    int16_t  tangent[2];    // octahedral, snorm16
+    uint16_t texCoords[2];  // half floats
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex has to match the attribute pointers in setupVertexAttributes");
+
+// per mesh dequantization of PackedVertex positions: Position = packed * scale + offset
+struct VertexQuantization {
+    glm::vec3 scale  = glm::vec3(1.0f);
+    glm::vec3 offset = glm::vec3(0.0f);
+};
+
+// box and sphere around a mesh, in object space. the defaults contain everything, a mesh nobody measured is never culled
+struct MeshBounds {
+    glm::vec3 min    = glm::vec3(-std::numeric_limits<float>::infinity());
+    glm::vec3 max    = glm::vec3(std::numeric_limits<float>::infinity());
+    glm::vec3 center = glm::vec3(0.0f);
+    float     radius = std::numeric_limits<float>::infinity();
+};
+
+inline size_t vertexStride(VertexFormat format)
+{
+    return format == VERTEX_PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+}
+
+// unit vector -> point in [-1, 1]^2, folding the lower hemisphere over the upper one
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+    float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    // meshes without normals leave them zeroed (or worse), any direction will do
+    if (!(length > 0.0f))
+        return glm::vec2(0.0f);
+    n /= length;
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return encoded;
+}
+
+// the box around the positions, mapped onto [-1, 1]^3
+inline VertexQuantization quantizationOf(const Vertex *vertices, size_t count)
+{
+    VertexQuantization quantization;
+    if (count == 0)
+        return quantization;
+    glm::vec3 lowest = vertices[0].Position, highest = vertices[0].Position;
+    for (size_t i = 1; i < count; i++)
+    {
+        lowest  = glm::min(lowest, vertices[i].Position);
+        highest = glm::max(highest, vertices[i].Position);
+    }
+    quantization.offset = (lowest + highest) * 0.5f;
+    // flat meshes still need a non zero scale on the flat axis
+    quantization.scale  = glm::max((highest - lowest) * 0.5f, glm::vec3(1e-6f));
+    return quantization;
+}
+
+// the box around the positions, and the sphere around them centered on the box
+inline MeshBounds boundsOf(const Vertex *vertices, size_t count)
+{
+    MeshBounds bounds;
+    if (count == 0)
+        return bounds;
+    bounds.min = bounds.max = vertices[0].Position;
+    for (size_t i = 1; i < count; i++)
+    {
+        bounds.min = glm::min(bounds.min, vertices[i].Position);
+        bounds.max = glm::max(bounds.max, vertices[i].Position);
+    }
+    bounds.center = (bounds.min + bounds.max) * 0.5f;
+    // the farthest vertex, tighter than half the box's diagonal for anything round
+    float farthest = 0.0f;
+    for (size_t i = 0; i < count; i++)
+    {
+        const glm::vec3 offset = vertices[i].Position - bounds.center;
+        farthest = std::max(farthest, glm::dot(offset, offset));
+    }
+    bounds.radius = std::sqrt(farthest);
+    return bounds;
+}
+
+inline void packVertices(const Vertex *vertices, size_t count, const VertexQuantization &quantization, PackedVertex *packed)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &vertex = vertices[i];
+        PackedVertex &out = packed[i];
+        const glm::vec3 position = (vertex.Position - quantization.offset) / quantization.scale;
+        // the bitangent only needs its handedness, the shader rebuilds it as cross(normal, tangent) * sign
+        const float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        out.position[0] = (int16_t)glm::packSnorm1x16(position.x);
+        out.position[1] = (int16_t)glm::packSnorm1x16(position.y);
+        out.position[2] = (int16_t)glm::packSnorm1x16(position.z);
+        out.position[3] = (int16_t)glm::packSnorm1x16(handedness);
+        const glm::vec2 normal  = octEncode(vertex.Normal);
+        const glm::vec2 tangent = octEncode(vertex.Tangent);
+        out.normal[0]  = (int16_t)glm::packSnorm1x16(normal.x);
+        out.normal[1]  = (int16_t)glm::packSnorm1x16(normal.y);
+        out.tangent[0] = (int16_t)glm::packSnorm1x16(tangent.x);
+        out.tangent[1] = (int16_t)glm::packSnorm1x16(tangent.y);
+        out.texCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+        out.texCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+    }
+}
+
+// points the attributes of the bound VAO at the bound vertex buffer, laid out as Vertex or PackedVertex
+inline void setupVertexAttributes(VertexFormat format = VERTEX_FLOAT)
+{
+    if (format == VERTEX_PACKED)
+    {
+        // normalized shorts come out in [-1, 1], the shader does the rest
+        // quantized position + bitangent sign
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+        // octahedral normal
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+        // half float texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+        // octahedral tangent
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, tangent));
+        // no bitangent
+        glDisableVertexAttribArray(4);
+        return;
+    }
+
+    // set the vertex attribute pointers
+    // vertex Positions
+    glEnableVertexAttribArray(0);	
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    // vertex normals
+    glEnableVertexAttribArray(1);	
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+    // vertex texture coords
+    glEnableVertexAttribArray(2);	
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+    // vertex tangent
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+    // vertex bitangent
+    glEnableVertexAttribArray(4);
+    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+}
+
+// one level of detail of a mesh: a range of its indices, relative to the mesh's own first index
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    float        error;     // how far the level strays from the full mesh, in object space units (see MeshSimplifier)
+};
+
+// where a mesh sits in the buffers of a MeshArena
+struct MeshRange {
+    unsigned int VAO;
+    int          baseVertex;    // added to every index, so indices stay relative to the mesh
+    unsigned int firstIndex;
+    unsigned int indexCount;
+    VertexFormat       format;
+    VertexQuantization quantization;
+};
+
+// one vertex buffer, one index buffer and one VAO shared by many meshes of the same vertex format. every mesh
+// draws its own range with glDrawElementsBaseVertex, drawing all of them needs a single VAO bind.
+// meshes are added first and uploaded together, the arena can't grow after upload(). all of them share one vertex format.
+class MeshArena {
+public:
+    explicit MeshArena(VertexFormat format = VERTEX_FLOAT) : format(format) {}
+
+    ~MeshArena()
+    {
+        if (VAO)
+            glDeleteVertexArrays(1, &VAO);
+        if (VBO)
+            glDeleteBuffers(1, &VBO);
+        if (EBO)
+            glDeleteBuffers(1, &EBO);
+    }
+
+    MeshArena(const MeshArena&) = delete;
+    MeshArena& operator=(const MeshArena&) = delete;
+
+    MeshArena(MeshArena &&other) noexcept
+        : format(other.format), pending(std::move(other.pending)), vertexTotal(other.vertexTotal), indexTotal(other.indexTotal),
+          VAO(other.VAO), VBO(other.VBO), EBO(other.EBO)
+    {
+        other.VAO = other.VBO = other.EBO = 0;
+        other.vertexTotal = other.indexTotal = 0;
+    }
+
+    MeshArena& operator=(MeshArena &&other) noexcept
+    {
+        MeshArena moved(std::move(other));
+        std::swap(format, moved.format);
+        std::swap(pending, moved.pending);
+        std::swap(vertexTotal, moved.vertexTotal);
+        std::swap(indexTotal, moved.indexTotal);
+        std::swap(VAO, moved.VAO);
+        std::swap(VBO, moved.VBO);
+        std::swap(EBO, moved.EBO);
+        return *this;
+    }
+
+    // reserves room for one mesh. its data is only read by upload() and has to stay where it is until then,
+    // except for the vertices of a packed arena: those are quantized right away
+    MeshRange add(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount)
+    {
+        if (!VAO)
+            glGenVertexArrays(1, &VAO);
+        MeshRange range;
+        range.VAO        = VAO;
+        range.baseVertex = (int)vertexTotal;
+        range.firstIndex = (unsigned int)indexTotal;
+        range.indexCount = (unsigned int)indexCount;
+        range.format     = format;
+        Pending mesh = { vertices, vertexCount, indices, indexCount, vector<PackedVertex>() };
+        if (format == VERTEX_PACKED)
+        {
+            range.quantization = quantizationOf(vertices, vertexCount);
+            mesh.packed.resize(vertexCount);
+            packVertices(vertices, vertexCount, range.quantization, mesh.packed.data());
+            mesh.vertices = nullptr;
+        }
+        pending.push_back(std::move(mesh));
+        vertexTotal += vertexCount;
+        indexTotal  += indexCount;
+        return range;
+    }
+
+    // creates both buffers at their final size and copies every added mesh in
+    void upload()
+    {
+        if (!VAO || VBO)
+            return;
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        const size_t stride = vertexStride(format);
+        glBufferData(GL_ARRAY_BUFFER, vertexTotal * stride, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexTotal * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+
+        size_t vertexOffset = 0, indexOffset = 0;
+        for (const Pending &mesh : pending)
+        {
+            const void *vertexData = format == VERTEX_PACKED ? (const void*)mesh.packed.data() : (const void*)mesh.vertices;
+            glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * stride, mesh.vertexCount * stride, vertexData);
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * sizeof(unsigned int), mesh.indexCount * sizeof(unsigned int), mesh.indices);
+            vertexOffset += mesh.vertexCount;
+            indexOffset  += mesh.indexCount;
+        }
+        pending.clear();
+        pending.shrink_to_fit();
+
+        setupVertexAttributes(format);
+        glBindVertexArray(0);
+    }
+
+    unsigned int vertexArray() const { return VAO; }
+    VertexFormat vertexFormat() const { return format; }
+    size_t vertexCount() const { return vertexTotal; }
+    size_t indexCount() const { return indexTotal; }
+
+private:
+    struct Pending {
+        const Vertex        *vertices;
+        size_t               vertexCount;
+        const unsigned int  *indices;
+        size_t               indexCount;
+        vector<PackedVertex> packed;    // owned copy of the vertices in a packed arena
+    };
+    VertexFormat    format;
+    vector<Pending> pending;
+    size_t vertexTotal = 0, indexTotal = 0;
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+};
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    unsigned int VAO = 0;
+    unsigned int indexCount = 0;
+    // range in the buffers, both 0 unless the mesh lives in a MeshArena
+    int          baseVertex = 0;
+    unsigned int firstIndex = 0;
+    // layout of the vertices on the GPU, the CPU side copy is always Vertex
+    VertexFormat       format = VERTEX_FLOAT;
+    VertexQuantization quantization;
+    // levels of detail, finest first, all in indices after each other. empty for a mesh with only its full detail
+    vector<MeshLod> lods;
+    unsigned int    lod = 0;    // the level drawElements draws
+    // object space bounds, filled in by Model. every level of detail lies within them
+    MeshBounds bounds;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, pass the vectors with std::move and nothing gets copied
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, VertexFormat format = VERTEX_FLOAT)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+        setupSamplerNames();
+    }
+
+    // uploads straight from memory the mesh doesn't own (a mapped mesh cache), vertices and indices stay empty
+    Mesh(const Vertex *vertices, size_t vertexCount, const unsigned int *indices, size_t indexCount, vector<Texture> textures,
+         VertexFormat format = VERTEX_FLOAT)
+        : textures(std::move(textures)), format(format)
+    {
+        setupMesh(vertices, vertexCount, indices, indexCount);
+        setupSamplerNames();
+    }
+
+    // a mesh in an arena, uploaded by the arena: it has no buffers of its own and doesn't own the VAO
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, const MeshRange &range)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)),
+          VAO(range.VAO), indexCount(range.indexCount), baseVertex(range.baseVertex), firstIndex(range.firstIndex),
+          format(range.format), quantization(range.quantization)
+    {
+        setupSamplerNames();
+    }
+
+    // a mesh owns its GL objects: it can be moved but not copied, and has to go before the context does
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    Mesh(Mesh &&other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+          VAO(other.VAO), indexCount(other.indexCount), baseVertex(other.baseVertex), firstIndex(other.firstIndex),
+          format(other.format), quantization(other.quantization), lods(std::move(other.lods)), lod(other.lod), bounds(other.bounds), VBO(other.VBO), EBO(other.EBO), boneVBO(other.boneVBO), samplerNames(std::move(other.samplerNames))
+    {
+        other.VAO = other.VBO = other.EBO = other.boneVBO = 0;
+        other.indexCount = 0;
+    }
+
+    Mesh& operator=(Mesh &&other) noexcept
+    {
+        if (this != &other)
+        {
+            deleteBuffers();
+            vertices     = std::move(other.vertices);
+            indices      = std::move(other.indices);
+            textures     = std::move(other.textures);
+            samplerNames = std::move(other.samplerNames);
+            VAO = other.VAO;
+            VBO = other.VBO;
+            EBO = other.EBO;
+            boneVBO = other.boneVBO;
+            indexCount = other.indexCount;
+            baseVertex = other.baseVertex;
+            firstIndex = other.firstIndex;
+            format       = other.format;
+            quantization = other.quantization;
+            lods         = std::move(other.lods);
+            lod          = other.lod;
+            bounds       = other.bounds;
+            other.VAO = other.VBO = other.EBO = other.boneVBO = 0;
+            other.indexCount = 0;
+        }
+        return *this;
+    }
+
+    ~Mesh()
+    {
+        deleteBuffers();
+    }
+
+    // frees the CPU side copy of vertices and indices, the GPU buffers are all Draw needs
+    void releaseCpuData()
+    {
+        vector<Vertex>().swap(vertices);
+        vector<unsigned int>().swap(indices);
+    }
+
+    // gives a skinned mesh its bone ids and weights, one per vertex, as attributes 5 (ivec4) and 6 (vec4) in a
+    // buffer next to the vertex one. only for a mesh with its own buffers, an arena's VAO is shared
+    void setBoneData(const vector<VertexBoneData> &bones)
+    {
+        if (!VBO)
+            return;
+        glBindVertexArray(VAO);
+        if (!boneVBO)
+            glGenBuffers(1, &boneVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, boneVBO);
+        glBufferData(GL_ARRAY_BUFFER, bones.size() * sizeof(VertexBoneData), bones.data(), GL_STATIC_DRAW);
+        // ids
+        glEnableVertexAttribArray(5);
+        glVertexAttribIPointer(5, 4, GL_INT, sizeof(VertexBoneData), (void*)offsetof(VertexBoneData, m_BoneIDs));
+        // weights
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBoneData), (void*)offsetof(VertexBoneData, m_Weights));
+        glBindVertexArray(0);
     }
 
     // render the mesh
     void Draw(Shader &shader) 
     {
-        // bind appropriate textures
+        bindTextures(shader);
+        bindQuantization(shader);
+        
+        // draw mesh
+        glBindVertexArray(VAO);
+        drawElements();
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // binds the mesh's textures and points the samplers at them
+    void bindTextures(Shader &shader)
+    {
+        for(unsigned int i = 0; i < textures.size(); i++)
+        {
+            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
+            // now set the sampler to the correct texture unit
+            shader.setInt(samplerNames[i], i);
+            // and finally bind the texture
+            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        }
+    }
+
+    // packed meshes decode their positions with these uniforms (packed_vertex.glsl)
+    void bindQuantization(Shader &shader)
+    {
+        if (format != VERTEX_PACKED)
+            return;
+        shader.setVec3("positionScale", quantization.scale);
+        shader.setVec3("positionOffset", quantization.offset);
+    }
+
+    // the index range of the selected level of detail, firstIndex included
+    MeshLod currentLod() const
+    {
+        if (lods.empty())
+            return { firstIndex, indexCount, 0.0f };
+        const MeshLod &level = lods[std::min<size_t>(lod, lods.size() - 1)];
+        return { firstIndex + level.firstIndex, level.indexCount, level.error };
+    }
+
+    // draws the mesh's triangles at the selected level of detail, with its VAO already bound
+    void drawElements()
+    {
+        const MeshLod range = currentLod();
+        glDrawElementsBaseVertex(GL_TRIANGLES, range.indexCount, GL_UNSIGNED_INT, (void*)(range.firstIndex * sizeof(unsigned int)), baseVertex);
+    }
+
+private:
+    // render data 
+    unsigned int VBO = 0, EBO = 0;
+    // bone ids and weights of a skinned mesh, 0 for the others
+    unsigned int boneVBO = 0;
+    // sampler uniform name per texture (texture_diffuseN, ...), built once instead of on every draw
+    vector<string> samplerNames;
+
+    // names each texture's sampler after its type and its running number within that type
+    void setupSamplerNames()
+    {
         unsigned int diffuseNr  = 1;
         unsigned int specularNr = 1;
         unsigned int normalNr   = 1;
         unsigned int heightNr   = 1;
+        samplerNames.clear();
+        samplerNames.reserve(textures.size());
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -72,29 +541,29 @@ public:
                 number = std::to_string(normalNr++); // transfer unsigned int to stream
              else if(name == "texture_height")
                 number = std::to_string(heightNr++); // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            samplerNames.push_back(name + number);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
+    // textures belong to the model, only the mesh's own objects go. the VAO of a mesh in an arena is the arena's
+    void deleteBuffers()
+    {
+        if (VAO && VBO)
+            glDeleteVertexArrays(1, &VAO);
+        if (VBO)
+            glDeleteBuffers(1, &VBO);
+        if (EBO)
+            glDeleteBuffers(1, &EBO);
+        if (boneVBO)
+            glDeleteBuffers(1, &boneVBO);
+        VAO = VBO = EBO = boneVBO = 0;
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex *vertexData, size_t vertexCount, const unsigned int *indexData, size_t indexCount)
     {
+        this->indexCount = (unsigned int)indexCount;
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -106,27 +575,20 @@ private:
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        if (format == VERTEX_PACKED)
+        {
+            quantization = quantizationOf(vertexData, vertexCount);
+            vector<PackedVertex> packed(vertexCount);
+            packVertices(vertexData, vertexCount, quantization, packed.data());
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+        }
+        else
+            glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);  
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+
+        setupVertexAttributes(format);
 
         glBindVertexArray(0);
     }
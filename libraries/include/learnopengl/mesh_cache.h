@@ -0,0 +1,463 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <learnopengl/mesh.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// read only memory mapping of a whole file
+class MappedFile
+{
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string &path)
+    {
+        close();
+#ifdef _WIN32
+        // shared for writing too, MeshCache rewrites the source time in the header of a mapped cache
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length) || length.QuadPart == 0)
+        {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (!mapping)
+        {
+            close();
+            return false;
+        }
+        bytes = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        length_ = (size_t)length.QuadPart;
+#else
+        int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0)
+            return false;
+        struct stat info;
+        if (fstat(descriptor, &info) != 0 || info.st_size == 0)
+        {
+            ::close(descriptor);
+            return false;
+        }
+        void *mapped = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        // the mapping keeps the file alive on its own
+        ::close(descriptor);
+        if (mapped == MAP_FAILED)
+            return false;
+        bytes = (const unsigned char*)mapped;
+        length_ = (size_t)info.st_size;
+#endif
+        if (!bytes)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes)
+            munmap((void*)bytes, length_);
+#endif
+        bytes = nullptr;
+        length_ = 0;
+    }
+
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length_; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length_ = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+// one mesh of a loaded cache, the pointers point into the mapped file and are only valid while the MeshCache lives
+struct CachedMesh
+{
+    const Vertex *vertices;
+    size_t vertexCount;
+    const unsigned int *indices;
+    size_t indexCount;
+    vector<Texture> textures;   // type and path filled in, id left 0 for the caller to load
+    vector<MeshLod> lods;       // levels of detail within indices, empty without any
+};
+
+// Binary cache of an imported model, written next to the source as <source>.meshcache.
+//
+// layout: header | mesh table | texture table | lod table | string bytes | vertex blob | index blob
+// the vertex blob is the meshes' Vertex arrays back to back and the index blob their indices (every level
+// of detail included), so a mesh can go straight from the mapping into glBufferData. sizeof(Vertex), the
+// import flags and the number of levels of detail asked for are part of the header, changing any of them
+// invalidates every cache.
+//
+// invalidation: the source's size and modification time are compared first. if only the time differs
+// (a fresh checkout, a touch) the source is hashed and the cache is still used when the hash matches. the
+// header then takes the new time, so only the first load after a touch pays for the hash.
+// files the source pulls in (.mtl, textures) are not tracked.
+class MeshCache
+{
+public:
+    MeshCache(const std::string &source, unsigned int importFlags, unsigned int lodLevels = 1)
+        : source(source), cachePath(source + ".meshcache"), flags(importFlags), levels(lodLevels)
+    {
+    }
+
+    const std::string &path() const { return cachePath; }
+
+    // maps the cache and checks it against the source, false if missing, stale or damaged
+    bool load()
+    {
+        loaded.clear();
+        if (!file.open(cachePath))
+            return false;
+
+        const unsigned char *bytes = file.data();
+        const size_t size = file.size();
+        Header header;
+        if (size < sizeof(Header))
+            return reject("truncated");
+        std::memcpy(&header, bytes, sizeof(Header));
+        if (std::memcmp(header.magic, MAGIC, 4) != 0 || header.version != VERSION)
+            return reject("unknown format");
+        if (header.vertexSize != sizeof(Vertex) || header.importFlags != flags || header.lodLevels != levels)
+            return reject("built with a different vertex layout, import flags or levels of detail");
+        if (!fresh(header))
+            return false;
+
+        // every table has to lie inside the file before anything is read from it
+        const uint64_t meshesEnd   = sizeof(Header) + header.meshCount * sizeof(MeshRecord);
+        const uint64_t texturesEnd = meshesEnd + header.textureCount * sizeof(TextureRecord);
+        const uint64_t lodsEnd     = texturesEnd + header.lodCount * sizeof(LodRecord);
+        if (meshesEnd > size || texturesEnd > size || lodsEnd > size || header.stringOffset + header.stringSize > size
+            || header.vertexOffset + header.vertexCount * sizeof(Vertex) > size
+            || header.indexOffset + header.indexCount * sizeof(unsigned int) > size)
+            return reject("truncated");
+
+        const MeshRecord *meshRecords = (const MeshRecord*)(bytes + sizeof(Header));
+        const TextureRecord *textureRecords = (const TextureRecord*)(bytes + meshesEnd);
+        const LodRecord *lodRecords = (const LodRecord*)(bytes + texturesEnd);
+        const char *strings = (const char*)(bytes + header.stringOffset);
+        const Vertex *vertexBlob = (const Vertex*)(bytes + header.vertexOffset);
+        const unsigned int *indexBlob = (const unsigned int*)(bytes + header.indexOffset);
+
+        loaded.reserve((size_t)header.meshCount);
+        for (uint64_t i = 0; i < header.meshCount; i++)
+        {
+            const MeshRecord &record = meshRecords[i];
+            if (record.firstVertex + record.vertexCount > header.vertexCount
+                || record.firstIndex + record.indexCount > header.indexCount
+                || record.firstTexture + record.textureCount > header.textureCount
+                || (uint64_t)record.firstLod + record.lodCount > header.lodCount)
+                return reject("mesh table out of range");
+
+            CachedMesh mesh;
+            mesh.vertices    = vertexBlob + record.firstVertex;
+            mesh.vertexCount = (size_t)record.vertexCount;
+            mesh.indices     = indexBlob + record.firstIndex;
+            mesh.indexCount  = (size_t)record.indexCount;
+            for (uint32_t t = 0; t < record.textureCount; t++)
+            {
+                const TextureRecord &texture = textureRecords[record.firstTexture + t];
+                if ((uint64_t)texture.typeOffset + texture.typeLength > header.stringSize
+                    || (uint64_t)texture.pathOffset + texture.pathLength > header.stringSize)
+                    return reject("texture table out of range");
+                Texture entry;
+                entry.id   = 0;
+                entry.type = std::string(strings + texture.typeOffset, texture.typeLength);
+                entry.path = std::string(strings + texture.pathOffset, texture.pathLength);
+                mesh.textures.push_back(entry);
+            }
+            for (uint32_t l = 0; l < record.lodCount; l++)
+            {
+                const LodRecord &lod = lodRecords[record.firstLod + l];
+                if ((uint64_t)lod.firstIndex + lod.indexCount > record.indexCount)
+                    return reject("lod table out of range");
+                mesh.lods.push_back({ lod.firstIndex, lod.indexCount, lod.error });
+            }
+            loaded.push_back(mesh);
+        }
+        return true;
+    }
+
+    const vector<CachedMesh> &meshes() const { return loaded; }
+
+    // writes the cache for meshes built from the source, their vertices/indices have to still be filled
+    bool store(const vector<Mesh> &meshes)
+    {
+        // the mapping may be of the file about to be replaced
+        loaded.clear();
+        file.close();
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, 4);
+        header.version     = VERSION;
+        header.vertexSize  = sizeof(Vertex);
+        header.importFlags = flags;
+        header.lodLevels   = levels;
+        if (!sourceInfo(header.sourceSize, header.sourceTime))
+            return false;
+        header.sourceHash = hashFile(source);
+
+        vector<MeshRecord> meshRecords;
+        vector<TextureRecord> textureRecords;
+        vector<LodRecord> lodRecords;
+        std::string strings;
+        for (const Mesh &mesh : meshes)
+        {
+            MeshRecord record;
+            record.firstVertex  = header.vertexCount;
+            record.vertexCount  = mesh.vertices.size();
+            record.firstIndex   = header.indexCount;
+            record.indexCount   = mesh.indices.size();
+            record.firstTexture = (uint32_t)textureRecords.size();
+            record.textureCount = (uint32_t)mesh.textures.size();
+            record.firstLod     = (uint32_t)lodRecords.size();
+            record.lodCount     = (uint32_t)mesh.lods.size();
+            for (const MeshLod &lod : mesh.lods)
+                lodRecords.push_back({ lod.firstIndex, lod.indexCount, lod.error, 0 });
+            for (const Texture &texture : mesh.textures)
+            {
+                TextureRecord entry;
+                entry.typeOffset = (uint32_t)strings.size();
+                entry.typeLength = (uint32_t)texture.type.size();
+                strings += texture.type;
+                entry.pathOffset = (uint32_t)strings.size();
+                entry.pathLength = (uint32_t)texture.path.size();
+                strings += texture.path;
+                textureRecords.push_back(entry);
+            }
+            header.vertexCount += record.vertexCount;
+            header.indexCount  += record.indexCount;
+            meshRecords.push_back(record);
+        }
+        header.meshCount    = meshRecords.size();
+        header.textureCount = textureRecords.size();
+        header.lodCount     = lodRecords.size();
+        header.stringOffset = sizeof(Header) + meshRecords.size() * sizeof(MeshRecord) + textureRecords.size() * sizeof(TextureRecord)
+                            + lodRecords.size() * sizeof(LodRecord);
+        header.stringSize   = strings.size();
+        header.vertexOffset = align(header.stringOffset + header.stringSize);
+        header.indexOffset  = align(header.vertexOffset + header.vertexCount * sizeof(Vertex));
+
+        // written under a temporary name, a crash half way never leaves a damaged cache behind
+        const std::string temporary = cachePath + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {
+                std::cout << "ERROR::MESH_CACHE:: can't write " << temporary << std::endl;
+                return false;
+            }
+            out.write((const char*)&header, sizeof(Header));
+            out.write((const char*)meshRecords.data(), meshRecords.size() * sizeof(MeshRecord));
+            out.write((const char*)textureRecords.data(), textureRecords.size() * sizeof(TextureRecord));
+            out.write((const char*)lodRecords.data(), lodRecords.size() * sizeof(LodRecord));
+            out.write(strings.data(), strings.size());
+            pad(out, header.vertexOffset);
+            for (const Mesh &mesh : meshes)
+                out.write((const char*)mesh.vertices.data(), mesh.vertices.size() * sizeof(Vertex));
+            pad(out, header.indexOffset);
+            for (const Mesh &mesh : meshes)
+                out.write((const char*)mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int));
+            if (!out)
+            {
+                std::cout << "ERROR::MESH_CACHE:: can't write " << temporary << std::endl;
+                return false;
+            }
+        }
+        std::error_code error;
+        std::filesystem::rename(temporary, cachePath, error);
+        if (error)
+        {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr char MAGIC[4] = { 'M', 'C', 'A', 'C' };
+    // also bumped when the import stores different meshes: 2 = optimized by MeshOptimizer, 3 = levels of detail
+    static const uint32_t VERSION = 3;
+
+    struct Header
+    {
+        char     magic[4];
+        uint32_t version = 0;
+        uint32_t vertexSize = 0;
+        uint32_t importFlags = 0;
+        uint32_t lodLevels = 1;
+        uint32_t padding = 0;
+        uint64_t sourceSize = 0;
+        int64_t  sourceTime = 0;
+        uint64_t sourceHash = 0;
+        uint64_t meshCount = 0;
+        uint64_t textureCount = 0;
+        uint64_t lodCount = 0;
+        uint64_t stringOffset = 0;
+        uint64_t stringSize = 0;
+        uint64_t vertexOffset = 0;
+        uint64_t vertexCount = 0;
+        uint64_t indexOffset = 0;
+        uint64_t indexCount = 0;
+    };
+
+    struct MeshRecord
+    {
+        uint64_t firstVertex;
+        uint64_t vertexCount;
+        uint64_t firstIndex;
+        uint64_t indexCount;
+        uint32_t firstTexture;
+        uint32_t textureCount;
+        uint32_t firstLod;
+        uint32_t lodCount;
+    };
+
+    struct TextureRecord
+    {
+        uint32_t typeOffset;
+        uint32_t typeLength;
+        uint32_t pathOffset;
+        uint32_t pathLength;
+    };
+
+    struct LodRecord
+    {
+        uint32_t firstIndex;
+        uint32_t indexCount;
+        float    error;
+        uint32_t padding;
+    };
+
+    std::string source;
+    std::string cachePath;
+    unsigned int flags;
+    unsigned int levels;
+    MappedFile file;
+    vector<CachedMesh> loaded;
+
+    bool reject(const char *reason)
+    {
+        std::cout << "MESH_CACHE:: ignoring " << cachePath << ", " << reason << std::endl;
+        loaded.clear();
+        file.close();
+        return false;
+    }
+
+    bool fresh(const Header &header)
+    {
+        uint64_t size;
+        int64_t time;
+        if (!sourceInfo(size, time))
+            return reject("source is missing");
+        if (size != header.sourceSize)
+            return reject("source changed");
+        // same size and time: nothing to read. only the time moved: the content decides
+        if (time != header.sourceTime)
+        {
+            if (hashFile(source) != header.sourceHash)
+                return reject("source changed");
+            updateSourceTime(time);
+        }
+        return true;
+    }
+
+    // writes the source's new time into the header in place. if it fails the next load hashes again, no harm done
+    void updateSourceTime(int64_t time)
+    {
+        std::fstream out(cachePath, std::ios::binary | std::ios::in | std::ios::out);
+        if (!out)
+            return;
+        out.seekp(offsetof(Header, sourceTime));
+        out.write((const char*)&time, sizeof(time));
+    }
+
+    bool sourceInfo(uint64_t &size, int64_t &time) const
+    {
+        std::error_code error;
+        size = (uint64_t)std::filesystem::file_size(source, error);
+        if (error)
+            return false;
+        time = (int64_t)std::filesystem::last_write_time(source, error).time_since_epoch().count();
+        return !error;
+    }
+
+    // FNV-1a over the whole file
+    static uint64_t hashFile(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        uint64_t hash = 14695981039346656037ull;
+        char buffer[1 << 16];
+        while (in)
+        {
+            in.read(buffer, sizeof(buffer));
+            for (std::streamsize i = 0; i < in.gcount(); i++)
+            {
+                hash ^= (unsigned char)buffer[i];
+                hash *= 1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + 15) & ~(uint64_t)15;
+    }
+
+    static void pad(std::ofstream &out, uint64_t offset)
+    {
+        static const char zeros[16] = {};
+        uint64_t position = (uint64_t)out.tellp();
+        if (offset > position)
+            out.write(zeros, (std::streamsize)(offset - position));
+    }
+};
+
+#endif
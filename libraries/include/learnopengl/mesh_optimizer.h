@@ -0,0 +1,369 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// how well an index order uses the post-transform vertex cache, simulated as a FIFO
+struct VertexCacheStats {
+    float acmr = 0.0f;  // average cache miss ratio, vertex shader runs per triangle: 0.5 at best, 3 at worst
+    float atvr = 0.0f;  // average transformed vertex ratio, vertex shader runs per vertex: 1 is ideal
+};
+
+// Import-time clean up of an indexed triangle mesh, every step keeps the mesh looking the same:
+//  1. bitwise identical vertices are merged
+//  2. triangles are reordered for the post-transform cache (Tom Forsyth's linear speed vertex cache optimisation)
+//  3. the runs of triangles that step 2 started from scratch are sorted outside-in, so the front most surfaces
+//     tend to draw first and hide what is behind them (the overdraw pass of Sander et al.'s Tipsify paper).
+//     kept only if the cache efficiency stays within OVERDRAW_THRESHOLD of step 2's
+//  4. vertices are renumbered in the order the indices first use them, fetches walk the vertex buffer forwards
+// meshes that aren't plain triangle lists (points, lines) are left alone.
+class MeshOptimizer {
+public:
+    static const unsigned int CACHE_SIZE = 16;      // FIFO the statistics simulate, small and common
+    static const unsigned int FORSYTH_CACHE = 32;   // LRU the reordering scores against
+    static constexpr float OVERDRAW_THRESHOLD = 1.05f;
+
+    struct Report {
+        size_t verticesBefore = 0, verticesAfter = 0;
+        size_t triangles = 0;
+        VertexCacheStats before, after;
+
+        // sums up several meshes, the ratios weighted by triangles and vertices
+        Report& operator+=(const Report &other)
+        {
+            const float triangleTotal = (float)(triangles + other.triangles);
+            if (triangleTotal > 0.0f)
+            {
+                before.acmr = (before.acmr * triangles + other.before.acmr * other.triangles) / triangleTotal;
+                after.acmr  = (after.acmr * triangles + other.after.acmr * other.triangles) / triangleTotal;
+            }
+            const float beforeTotal = (float)(verticesBefore + other.verticesBefore);
+            const float afterTotal  = (float)(verticesAfter + other.verticesAfter);
+            if (beforeTotal > 0.0f)
+                before.atvr = (before.atvr * verticesBefore + other.before.atvr * other.verticesBefore) / beforeTotal;
+            if (afterTotal > 0.0f)
+                after.atvr = (after.atvr * verticesAfter + other.after.atvr * other.verticesAfter) / afterTotal;
+            verticesBefore += other.verticesBefore;
+            verticesAfter  += other.verticesAfter;
+            triangles      += other.triangles;
+            return *this;
+        }
+    };
+
+    // runs every step on the mesh in place. touches no GL state, fine on any thread
+    static Report optimize(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        Report report;
+        report.verticesBefore = report.verticesAfter = vertices.size();
+        report.triangles = indices.size() / 3;
+        report.before = report.after = cacheStats(indices, vertices.size());
+        if (indices.empty() || indices.size() % 3 != 0)
+            return report;
+
+        removeDuplicates(vertices, indices);
+        optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, vertices);
+        optimizeVertexFetch(vertices, indices);
+
+        report.verticesAfter = vertices.size();
+        report.after = cacheStats(indices, vertices.size());
+        return report;
+    }
+
+    // simulates a FIFO cache of cacheSize over the triangle list
+    static VertexCacheStats cacheStats(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = CACHE_SIZE)
+    {
+        VertexCacheStats stats;
+        if (indices.size() < 3 || vertexCount == 0)
+            return stats;
+        // timestamp of the vertex's last load, it is still cached while fewer than cacheSize loads happened since
+        vector<size_t> loadedAt(vertexCount, 0);
+        vector<char>   used(vertexCount, 0);
+        size_t misses = 0, referenced = 0;
+        for (unsigned int index : indices)
+        {
+            if (!used[index])
+            {
+                used[index] = 1;
+                referenced++;
+            }
+            if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > cacheSize)
+            {
+                misses++;
+                loadedAt[index] = misses;
+            }
+        }
+        stats.acmr = (float)misses / (float)(indices.size() / 3);
+        stats.atvr = (float)misses / (float)referenced;
+        return stats;
+    }
+
+    // merges bitwise identical vertices, the survivors keep their first order
+    static void removeDuplicates(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        struct Hash {
+            size_t operator()(const Vertex *vertex) const
+            {
+                const unsigned char *bytes = (const unsigned char*)vertex;
+                uint64_t hash = 14695981039346656037ull;
+                for (size_t i = 0; i < sizeof(Vertex); i++)
+                {
+                    hash ^= bytes[i];
+                    hash *= 1099511628211ull;
+                }
+                return (size_t)hash;
+            }
+        };
+        struct Equal {
+            bool operator()(const Vertex *a, const Vertex *b) const { return std::memcmp(a, b, sizeof(Vertex)) == 0; }
+        };
+
+        unordered_map<const Vertex*, unsigned int, Hash, Equal> unique;
+        unique.reserve(vertices.size());
+        vector<unsigned int> remap(vertices.size());
+        vector<Vertex> merged;
+        merged.reserve(vertices.size());
+        for (size_t i = 0; i < vertices.size(); i++)
+        {
+            auto found = unique.emplace(&vertices[i], (unsigned int)merged.size());
+            if (found.second)
+                merged.push_back(vertices[i]);
+            remap[i] = found.first->second;
+        }
+        if (merged.size() == vertices.size())
+            return;
+        for (unsigned int &index : indices)
+            index = remap[index];
+        vertices.swap(merged);
+    }
+
+    // Forsyth: greedily emits the triangle whose vertices score best, a vertex scores high when it is recently
+    // used (in the simulated cache) and when few triangles are left to use it
+    static void optimizeVertexCache(vector<unsigned int> &indices, size_t vertexCount)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+            return;
+
+        // triangles of every vertex, packed
+        vector<unsigned int> offsets(vertexCount + 1, 0);
+        for (unsigned int index : indices)
+            offsets[index + 1]++;
+        for (size_t i = 0; i < vertexCount; i++)
+            offsets[i + 1] += offsets[i];
+        vector<unsigned int> adjacency(indices.size());
+        vector<unsigned int> live(vertexCount, 0);     // triangles not emitted yet
+        for (size_t t = 0; t < triangleCount; t++)
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int vertex = indices[t * 3 + k];
+                adjacency[offsets[vertex] + live[vertex]++] = (unsigned int)t;
+            }
+
+        vector<int>   cachePosition(vertexCount, -1);
+        vector<float> vertexScore(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            vertexScore[v] = forsythScore(-1, live[v]);
+        vector<float> triangleScore(triangleCount);
+        vector<char>  emitted(triangleCount, 0);
+        for (size_t t = 0; t < triangleCount; t++)
+            triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+        vector<unsigned int> cache, nextCache;
+        cache.reserve(FORSYTH_CACHE + 3);
+        nextCache.reserve(FORSYTH_CACHE + 3);
+        vector<unsigned int> result;
+        result.reserve(indices.size());
+
+        size_t cursor = 0;   // everything before it was emitted, for when the cache has nothing to offer
+        int best = -1;
+        for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+        {
+            if (best < 0)
+            {
+                // start somewhere new: the best scored triangle would need a full scan, the next one in order is fine
+                while (emitted[cursor])
+                    cursor++;
+                best = (int)cursor;
+            }
+
+            const unsigned int *triangle = &indices[best * 3];
+            result.insert(result.end(), triangle, triangle + 3);
+            emitted[best] = 1;
+
+            // the triangle's vertices go to the front, the rest of the cache moves back
+            nextCache.assign(triangle, triangle + 3);
+            for (unsigned int vertex : cache)
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                    nextCache.push_back(vertex);
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int vertex = triangle[k];
+                unsigned int *first = &adjacency[offsets[vertex]];
+                unsigned int *last  = first + live[vertex];
+                *std::find(first, last, (unsigned int)best) = *(last - 1);
+                live[vertex]--;
+            }
+
+            // rescore what is (or just was) in the cache, and pick the best triangle among theirs
+            for (size_t i = 0; i < nextCache.size(); i++)
+            {
+                unsigned int vertex = nextCache[i];
+                cachePosition[vertex] = i < FORSYTH_CACHE ? (int)i : -1;
+            }
+            best = -1;
+            float bestScore = -1.0f;
+            for (unsigned int vertex : nextCache)
+            {
+                float score = forsythScore(cachePosition[vertex], live[vertex]);
+                float delta = score - vertexScore[vertex];
+                vertexScore[vertex] = score;
+                for (unsigned int i = offsets[vertex]; i < offsets[vertex] + live[vertex]; i++)
+                {
+                    unsigned int t = adjacency[i];
+                    triangleScore[t] += delta;
+                    if (triangleScore[t] > bestScore)
+                    {
+                        bestScore = triangleScore[t];
+                        best = (int)t;
+                    }
+                }
+            }
+            if (nextCache.size() > FORSYTH_CACHE)
+                nextCache.resize(FORSYTH_CACHE);
+            cache.swap(nextCache);
+        }
+        indices.swap(result);
+    }
+
+    // sorts the clusters the cache order is made of so that outward facing, outer clusters come first
+    static void optimizeOverdraw(vector<unsigned int> &indices, const vector<Vertex> &vertices)
+    {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount < 2)
+            return;
+
+        // a triangle missing the cache on all three vertices starts a new cluster, reordering at those seams
+        // costs (almost) nothing
+        vector<size_t> clusterStart;
+        {
+            vector<size_t> loadedAt(vertices.size(), 0);
+            size_t misses = 0;
+            for (size_t t = 0; t < triangleCount; t++)
+            {
+                int triangleMisses = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    unsigned int index = indices[t * 3 + k];
+                    if (loadedAt[index] == 0 || misses + 1 - loadedAt[index] > CACHE_SIZE)
+                    {
+                        misses++;
+                        loadedAt[index] = misses;
+                        triangleMisses++;
+                    }
+                }
+                if (t == 0 || triangleMisses == 3)
+                    clusterStart.push_back(t);
+            }
+        }
+        if (clusterStart.size() < 2)
+            return;
+        clusterStart.push_back(triangleCount);
+
+        glm::vec3 meshCenter(0.0f);
+        for (const Vertex &vertex : vertices)
+            meshCenter += vertex.Position;
+        meshCenter /= (float)vertices.size();
+
+        struct Cluster {
+            size_t first, count;
+            float  key;
+        };
+        vector<Cluster> clusters;
+        clusters.reserve(clusterStart.size() - 1);
+        for (size_t c = 0; c + 1 < clusterStart.size(); c++)
+        {
+            glm::vec3 center(0.0f), normal(0.0f);
+            float area = 0.0f;
+            for (size_t t = clusterStart[c]; t < clusterStart[c + 1]; t++)
+            {
+                const glm::vec3 &a = vertices[indices[t * 3]].Position;
+                const glm::vec3 &b = vertices[indices[t * 3 + 1]].Position;
+                const glm::vec3 &d = vertices[indices[t * 3 + 2]].Position;
+                glm::vec3 cross = glm::cross(b - a, d - a);
+                float weight = glm::length(cross);
+                center += (a + b + d) * (weight / 3.0f);
+                normal += cross;
+                area   += weight;
+            }
+            Cluster cluster;
+            cluster.first = clusterStart[c];
+            cluster.count = clusterStart[c + 1] - clusterStart[c];
+            cluster.key   = 0.0f;
+            float normalLength = glm::length(normal);
+            if (area > 0.0f && normalLength > 0.0f)
+                cluster.key = glm::dot(center / area - meshCenter, normal / normalLength);
+            clusters.push_back(cluster);
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b) { return a.key > b.key; });
+
+        vector<unsigned int> sorted;
+        sorted.reserve(indices.size());
+        for (const Cluster &cluster : clusters)
+            sorted.insert(sorted.end(), indices.begin() + cluster.first * 3, indices.begin() + (cluster.first + cluster.count) * 3);
+
+        const float cacheBefore = cacheStats(indices, vertices.size()).acmr;
+        const float cacheAfter  = cacheStats(sorted, vertices.size()).acmr;
+        if (cacheAfter <= cacheBefore * OVERDRAW_THRESHOLD)
+            indices.swap(sorted);
+    }
+
+    // renumbers the vertices in the order the indices first reach them, unreferenced ones are dropped
+    static void optimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+    {
+        const unsigned int UNUSED = ~0u;
+        vector<unsigned int> remap(vertices.size(), UNUSED);
+        vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (unsigned int &index : indices)
+        {
+            if (remap[index] == UNUSED)
+            {
+                remap[index] = (unsigned int)ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices.swap(ordered);
+    }
+
+private:
+    static float forsythScore(int cachePosition, unsigned int liveTriangles)
+    {
+        // nothing left to draw with it
+        if (liveTriangles == 0)
+            return -1.0f;
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // the last triangle's vertices score the same, whichever order they were used in
+            if (cachePosition < 3)
+                score = 0.75f;
+            else
+                score = std::pow(1.0f - (float)(cachePosition - 3) / (float)(FORSYTH_CACHE - 3), 1.5f);
+        }
+        // vertices with few triangles left get finished off first
+        return score + 2.0f / std::sqrt((float)liveTriangles);
+    }
+};
+#endif
@@ -0,0 +1,426 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/mesh_optimizer.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Quadric error edge collapse (Garland & Heckbert) that only rewrites indices: every collapse moves a vertex
+// onto a neighbour that already exists, so all levels of detail share one vertex buffer.
+//
+// the error is measured on welded positions, vertices that only differ in their normal or uv (a seam) are one
+// point to it. collapsing a point moves each of its vertices onto the vertex of the target point it shares a
+// triangle with, so a point on a seam can only slide along that seam and uv islands stay apart. open borders
+// and seams get extra planes along them so their outline holds. collapses that would flip a triangle are skipped.
+class MeshSimplifier {
+public:
+    // returns the simplified triangle list, at most targetIndexCount indices unless that needs a collapse with
+    // more than targetError. error receives the largest error of the collapses that were made. errors are the
+    // rms distance of the moved point to the planes of the triangles it stands for, in object space
+    static vector<unsigned int> simplify(const vector<Vertex> &vertices, const vector<unsigned int> &indices,
+                                         size_t targetIndexCount, float targetError = FLT_MAX, float *error = nullptr)
+    {
+        if (error)
+            *error = 0.0f;
+        if (indices.size() % 3 != 0 || indices.size() <= targetIndexCount)
+            return indices;
+
+        MeshSimplifier simplifier(vertices, indices);
+        return simplifier.run(targetIndexCount, targetError, error);
+    }
+
+    // builds up to levels levels of detail, each with about half the triangles of the one before, all simplified
+    // from the full mesh. their indices are appended to indices, level 0 is the full mesh as it was. stops early
+    // once a level can't take away at least LOD_MIN_REDUCTION of the triangles
+    static vector<MeshLod> buildLods(const vector<Vertex> &vertices, vector<unsigned int> &indices, unsigned int levels)
+    {
+        // the levels get appended to indices, each one is simplified from this copy of the full mesh
+        const vector<unsigned int> full(indices);
+        vector<MeshLod> lods;
+        lods.push_back({ 0, (unsigned int)full.size(), 0.0f });
+        for (unsigned int level = 1; level < levels; level++)
+        {
+            float error = 0.0f;
+            vector<unsigned int> lod = simplify(vertices, full, (full.size() >> level) / 3 * 3, FLT_MAX, &error);
+            if (lod.empty() || lod.size() > lods.back().indexCount * (1.0 - LOD_MIN_REDUCTION))
+                break;
+            MeshOptimizer::optimizeVertexCache(lod, vertices.size());
+            // a coarser level never claims to be more accurate than a finer one
+            lods.push_back({ (unsigned int)indices.size(), (unsigned int)lod.size(), std::max(error, lods.back().error) });
+            indices.insert(indices.end(), lod.begin(), lod.end());
+        }
+        return lods;
+    }
+
+private:
+    // symmetric 4x4 matrix of a sum of squared plane distances, and the sum of the planes' weights
+    struct Quadric {
+        double a2 = 0, ab = 0, ac = 0, ad = 0, b2 = 0, bc = 0, bd = 0, c2 = 0, cd = 0, d2 = 0;
+        double weight = 0;
+
+        static Quadric plane(const glm::dvec3 &normal, double distance, double weight)
+        {
+            Quadric q;
+            q.a2 = normal.x * normal.x * weight; q.ab = normal.x * normal.y * weight; q.ac = normal.x * normal.z * weight;
+            q.ad = normal.x * distance * weight; q.b2 = normal.y * normal.y * weight; q.bc = normal.y * normal.z * weight;
+            q.bd = normal.y * distance * weight; q.c2 = normal.z * normal.z * weight; q.cd = normal.z * distance * weight;
+            q.d2 = distance * distance * weight;
+            q.weight = weight;
+            return q;
+        }
+
+        Quadric& operator+=(const Quadric &o)
+        {
+            a2 += o.a2; ab += o.ab; ac += o.ac; ad += o.ad; b2 += o.b2;
+            bc += o.bc; bd += o.bd; c2 += o.c2; cd += o.cd; d2 += o.d2;
+            weight += o.weight;
+            return *this;
+        }
+
+        double error(const glm::dvec3 &p) const
+        {
+            double e = a2 * p.x * p.x + 2 * ab * p.x * p.y + 2 * ac * p.x * p.z + 2 * ad * p.x
+                     + b2 * p.y * p.y + 2 * bc * p.y * p.z + 2 * bd * p.y
+                     + c2 * p.z * p.z + 2 * cd * p.z + d2;
+            return weight > 0.0 ? std::sqrt(std::max(e, 0.0) / weight) : 0.0;
+        }
+    };
+
+    struct Collapse {
+        double       cost;
+        unsigned int from, to;  // points
+        unsigned int version;   // the from point's version when queued, stale entries are skipped
+
+        bool operator>(const Collapse &other) const { return cost > other.cost; }
+    };
+
+    const vector<Vertex>       &vertices;
+    const vector<unsigned int> &indices;
+
+    vector<unsigned int>         point;      // vertex -> welded point
+    vector<glm::dvec3>           position;   // per point
+    vector<vector<unsigned int>> wedges;     // point -> its vertices
+    vector<Quadric>              quadric;    // per point
+    vector<vector<unsigned int>> triangles;  // point -> triangles using it, may hold dead ones
+    vector<unsigned int>         corner;     // triangle corners as vertices, kept up to date
+    vector<char>                 alive;      // per triangle
+    vector<char>                 removed;    // per point, collapsed onto another one
+    vector<unsigned int>         version;    // per point
+    vector<unsigned int>         remap;      // scratch: vertex -> vertex it moves to in a collapse
+
+    MeshSimplifier(const vector<Vertex> &vertices, const vector<unsigned int> &indices)
+        : vertices(vertices), indices(indices)
+    {
+        weld();
+        const size_t triangleCount = indices.size() / 3;
+        corner = indices;
+        alive.assign(triangleCount, 1);
+        triangles.resize(position.size());
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const unsigned int a = point[corner[t * 3]], b = point[corner[t * 3 + 1]], c = point[corner[t * 3 + 2]];
+            if (a == b || a == c || b == c)
+            {
+                alive[t] = 0;
+                continue;
+            }
+            triangles[a].push_back((unsigned int)t);
+            triangles[b].push_back((unsigned int)t);
+            triangles[c].push_back((unsigned int)t);
+        }
+        removed.assign(position.size(), 0);
+        version.assign(position.size(), 0);
+        remap.assign(vertices.size(), ~0u);
+        buildQuadrics();
+    }
+
+    void weld()
+    {
+        struct Hash {
+            size_t operator()(const glm::vec3 &p) const
+            {
+                uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (size_t)(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+            }
+        };
+        unordered_map<glm::vec3, unsigned int, Hash> points;
+        points.reserve(vertices.size());
+        point.resize(vertices.size());
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            auto found = points.emplace(vertices[v].Position, (unsigned int)position.size());
+            if (found.second)
+            {
+                position.push_back(glm::dvec3(vertices[v].Position));
+                wedges.emplace_back();
+            }
+            point[v] = found.first->second;
+            wedges[point[v]].push_back((unsigned int)v);
+        }
+    }
+
+    void buildQuadrics()
+    {
+        quadric.assign(position.size(), Quadric());
+        // edge between two vertices -> number of triangles using it. an edge only one triangle uses is either
+        // an open border or one side of a seam
+        unordered_map<uint64_t, int> edges;
+        edges.reserve(indices.size());
+        for (size_t t = 0; t < alive.size(); t++)
+        {
+            if (!alive[t])
+                continue;
+            const unsigned int c[3] = { point[corner[t * 3]], point[corner[t * 3 + 1]], point[corner[t * 3 + 2]] };
+            glm::dvec3 normal = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            double length = glm::length(normal);
+            for (int k = 0; k < 3; k++)
+                edges[edgeKey(corner[t * 3 + k], corner[t * 3 + (k + 1) % 3])]++;
+            if (length <= 0.0)
+                continue;
+            normal /= length;
+            Quadric q = Quadric::plane(normal, -glm::dot(normal, position[c[0]]), 1.0);
+            for (int k = 0; k < 3; k++)
+                quadric[c[k]] += q;
+        }
+        // border edges: a plane through the edge, standing on the triangle
+        for (size_t t = 0; t < alive.size(); t++)
+        {
+            if (!alive[t])
+                continue;
+            const unsigned int c[3] = { point[corner[t * 3]], point[corner[t * 3 + 1]], point[corner[t * 3 + 2]] };
+            glm::dvec3 normal = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int a = c[k], b = c[(k + 1) % 3];
+                if (edges[edgeKey(corner[t * 3 + k], corner[t * 3 + (k + 1) % 3])] != 1)
+                    continue;
+                glm::dvec3 edge = position[b] - position[a];
+                glm::dvec3 side = glm::cross(edge, normal);
+                double length = glm::length(side);
+                if (length <= 0.0)
+                    continue;
+                side /= length;
+                Quadric q = Quadric::plane(side, -glm::dot(side, position[a]), BORDER_WEIGHT);
+                quadric[a] += q;
+                quadric[b] += q;
+            }
+        }
+    }
+
+    static const int BORDER_WEIGHT = 10;
+    static constexpr double LOD_MIN_REDUCTION = 0.1;
+
+    static uint64_t edgeKey(unsigned int a, unsigned int b)
+    {
+        return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+    }
+
+    // works out where each of p's vertices goes when p collapses onto q: onto the vertex of q it shares a
+    // triangle with. false if one of them has none (it would have to cross a seam) or two vertices of p would
+    // end up on the same one (the seam would close). fills remap for p's vertices
+    bool mapWedges(unsigned int p, unsigned int q)
+    {
+        for (unsigned int w : wedges[p])
+            remap[w] = ~0u;
+        for (unsigned int t : triangles[p])
+        {
+            if (!alive[t])
+                continue;
+            const unsigned int *c = &corner[t * 3];
+            for (int k = 0; k < 3; k++)
+            {
+                if (point[c[k]] != p)
+                    continue;
+                for (int j = 0; j < 3; j++)
+                    if (point[c[j]] == q && remap[c[k]] == ~0u)
+                        remap[c[k]] = c[j];
+            }
+        }
+        // only the vertices still in use count
+        unsigned int used = 0, mapped = 0;
+        for (unsigned int w : wedges[p])
+        {
+            bool inUse = false;
+            for (unsigned int t : triangles[p])
+                if (alive[t] && (corner[t * 3] == w || corner[t * 3 + 1] == w || corner[t * 3 + 2] == w))
+                {
+                    inUse = true;
+                    break;
+                }
+            if (!inUse)
+                continue;
+            used++;
+            if (remap[w] == ~0u)
+                return false;
+            for (unsigned int other : wedges[p])
+                if (other != w && remap[other] == remap[w])
+                    return false;
+            mapped++;
+        }
+        return used > 0 && used == mapped;
+    }
+
+    // the cheapest neighbour to collapse p onto
+    bool bestCollapse(unsigned int p, Collapse &collapse)
+    {
+        collapse.cost = DBL_MAX;
+        for (unsigned int t : triangles[p])
+        {
+            if (!alive[t])
+                continue;
+            for (int k = 0; k < 3; k++)
+            {
+                unsigned int q = point[corner[t * 3 + k]];
+                if (q == p)
+                    continue;
+                Quadric sum = quadric[p];
+                sum += quadric[q];
+                double cost = sum.error(position[q]);
+                if (cost < collapse.cost && (wedges[p].size() == 1 || mapWedges(p, q)))
+                {
+                    collapse.cost = cost;
+                    collapse.to   = q;
+                }
+            }
+        }
+        collapse.from    = p;
+        collapse.version = version[p];
+        return collapse.cost < DBL_MAX;
+    }
+
+    // moving p onto q must not turn any of p's remaining triangles over
+    bool flips(unsigned int p, unsigned int q)
+    {
+        for (unsigned int t : triangles[p])
+        {
+            if (!alive[t])
+                continue;
+            const unsigned int c[3] = { point[corner[t * 3]], point[corner[t * 3 + 1]], point[corner[t * 3 + 2]] };
+            if (c[0] == q || c[1] == q || c[2] == q)
+                continue;
+            glm::dvec3 before = glm::cross(position[c[1]] - position[c[0]], position[c[2]] - position[c[0]]);
+            glm::dvec3 moved[3];
+            for (int k = 0; k < 3; k++)
+                moved[k] = position[c[k] == p ? q : c[k]];
+            glm::dvec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+            if (glm::dot(before, after) <= 0.0)
+                return true;
+        }
+        return false;
+    }
+
+    vector<unsigned int> run(size_t targetIndexCount, float targetError, float *error)
+    {
+        priority_queue<Collapse, vector<Collapse>, greater<Collapse>> queue;
+        for (unsigned int p = 0; p < position.size(); p++)
+        {
+            Collapse collapse;
+            if (bestCollapse(p, collapse))
+                queue.push(collapse);
+        }
+
+        size_t liveIndices = 0;
+        for (char a : alive)
+            liveIndices += a ? 3 : 0;
+        double worst = 0.0;
+
+        while (liveIndices > targetIndexCount && !queue.empty())
+        {
+            Collapse collapse = queue.top();
+            queue.pop();
+            const unsigned int p = collapse.from;
+            if (collapse.version != version[p] || removed[p])
+                continue;
+            const unsigned int q = collapse.to;
+            if (removed[q])
+            {
+                // the target went away since, look again
+                version[p]++;
+                if (bestCollapse(p, collapse))
+                    queue.push(collapse);
+                continue;
+            }
+            if (collapse.cost > targetError)
+                break;
+            if (flips(p, q) || !mapWedges(p, q))
+            {
+                // retried once a neighbour changes
+                version[p]++;
+                continue;
+            }
+
+            // p goes onto q: triangles using both die, the rest switch over to q's vertices
+            removed[p] = 1;
+            quadric[q] += quadric[p];
+            worst = std::max(worst, collapse.cost);
+            for (unsigned int t : triangles[p])
+            {
+                if (!alive[t])
+                    continue;
+                unsigned int *c = &corner[t * 3];
+                if (point[c[0]] == q || point[c[1]] == q || point[c[2]] == q)
+                {
+                    alive[t] = 0;
+                    liveIndices -= 3;
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                    if (point[c[k]] == p)
+                        c[k] = remap[c[k]];
+                triangles[q].push_back(t);
+            }
+            triangles[p].clear();
+
+            // q and everything around it has new costs
+            vector<unsigned int> touched(1, q);
+            for (unsigned int t : triangles[q])
+                if (alive[t])
+                    for (int k = 0; k < 3; k++)
+                        touched.push_back(point[corner[t * 3 + k]]);
+            std::sort(touched.begin(), touched.end());
+            touched.erase(std::unique(touched.begin(), touched.end()), touched.end());
+            for (unsigned int r : touched)
+            {
+                version[r]++;
+                if (bestCollapse(r, collapse))
+                    queue.push(collapse);
+            }
+            compact(q);
+        }
+
+        if (error)
+            *error = (float)worst;
+        return output();
+    }
+
+    // drops dead triangles from a point's list once in a while, they pile up on busy points
+    void compact(unsigned int p)
+    {
+        vector<unsigned int> &list = triangles[p];
+        if (list.size() < 32)
+            return;
+        list.erase(std::remove_if(list.begin(), list.end(), [this](unsigned int t) { return !alive[t]; }), list.end());
+    }
+
+    vector<unsigned int> output()
+    {
+        vector<unsigned int> result;
+        for (size_t t = 0; t < alive.size(); t++)
+            if (alive[t])
+                result.insert(result.end(), &corner[t * 3], &corner[t * 3] + 3);
+        return result;
+    }
+};
+#endif
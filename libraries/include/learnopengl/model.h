@@ -10,91 +10,325 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <learnopengl/camera.h>
+#include <learnopengl/frustum.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mesh_cache.h>
+#include <learnopengl/mesh_optimizer.h>
+#include <learnopengl/mesh_simplifier.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
+#include <learnopengl/thread_pool.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 using namespace std;
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
 
+// how a Model is loaded and kept
+struct ModelOptions
+{
+    bool gamma = false;
+    // false frees every mesh's vertices and indices once they are on the GPU. true keeps them, copied out of the
+    // mesh cache when the model loads from it
+    bool keepMeshData = true;
+    // true puts all meshes in one shared vertex and index buffer (arena) instead of buffers per mesh
+    bool packed = false;
+    // VERTEX_PACKED quantizes the vertices on upload, the shaders have to decode them (packed_vertex.glsl)
+    VertexFormat format = VERTEX_FLOAT;
+    // levels of detail built per mesh at import, 1 keeps only the full mesh. see selectLod
+    unsigned int lodLevels = 1;
+};
+
 class Model 
 {
 public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    MeshArena       arena;  // every mesh's vertices and indices in packed mode, empty otherwise
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    MeshOptimizer::Report optimization;  // all meshes together, only filled when the model went through ASSIMP
+    CullingStats culling;   // meshes the culled Draw tested and dropped, added up until culling.reset()
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // with a TextureStreamer set on the TextureRegistry the textures load in the background, the model is ready
+    // to draw once its meshes are and shows placeholders until then.
+    Model(string const &path, bool gamma = false) : Model(path, optionsWithGamma(gamma))
+    {
+    }
+
+    Model(string const &path, const ModelOptions &options)
+        : arena(options.format), gammaCorrection(options.gamma), packed(options.packed), format(options.format),
+          lodLevels(std::max(options.lodLevels, 1u)), keepMeshData(options.keepMeshData)
     {
         loadModel(path);
+        if(!keepMeshData)
+            for(Mesh &mesh : meshes)
+                mesh.releaseCpuData();
+    }
+
+    // picks every mesh's level of detail for drawing the model with the given model matrix: the coarsest level
+    // whose error, projected onto a viewport viewportHeight pixels high, stays within pixelError pixels.
+    // the distance is taken to the nearest point of the mesh's bounding sphere
+    void selectLod(const Camera &camera, const glm::mat4 &transform, float viewportHeight, float pixelError = 1.0f)
+    {
+        // errors grow with the largest axis scale of the transform
+        const float scale = FrustumCuller::maxScale(transform);
+        // pixels one world space unit covers at distance 1
+        const float pixelsAtOne = viewportHeight / (2.0f * std::tan(glm::radians(camera.Zoom) * 0.5f));
+        for(Mesh &mesh : meshes)
+        {
+            mesh.lod = 0;
+            if(mesh.lods.size() < 2)
+                continue;
+            // a mesh without bounds is measured from the model's origin
+            float distance = glm::length(glm::vec3(transform[3]) - camera.Position);
+            if(std::isfinite(mesh.bounds.radius))
+                distance = glm::length(glm::vec3(transform * glm::vec4(mesh.bounds.center, 1.0f)) - camera.Position) - mesh.bounds.radius * scale;
+            const float pixelsPerUnit = pixelsAtOne / std::max(distance, 1e-4f) * scale;
+            for(unsigned int i = 1; i < mesh.lods.size() && mesh.lods[i].error * pixelsPerUnit <= pixelError; i++)
+                mesh.lod = i;
+        }
+    }
+
+    // indices the selected levels of detail draw, all meshes together
+    size_t drawnIndexCount() const
+    {
+        size_t count = 0;
+        for(const Mesh &mesh : meshes)
+            count += mesh.currentLod().indexCount;
+        return count;
     }
 
     // draws the model, and thus all its meshes
     void Draw(Shader &shader)
     {
-        for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+        drawMeshes(shader, nullptr);
+    }
+
+    // draws only the meshes whose bounds reach into the frustum. transform is the model matrix the shader
+    // is set up with, the frustum is in world space (Frustum::of)
+    void Draw(Shader &shader, const Frustum &frustum, const glm::mat4 &transform)
+    {
+        culler.clear();
+        const float scale = FrustumCuller::maxScale(transform);
+        for(const Mesh &mesh : meshes)
+            culler.add(mesh.bounds, transform, scale);
+        culler.cull(frustum);
+        culling.tested += culler.lastStats().tested;
+        culling.culled += culler.lastStats().culled;
+        drawMeshes(shader, &culler);
     }
     
 private:
+    bool packed;
+    VertexFormat format;
+    unsigned int lodLevels;
+    bool keepMeshData;
+    FrustumCuller culler;   // scratch space of the culled Draw
+    // textures_loaded by the path the model's materials use, and the model's share of the texture registry
+    unordered_map<string, size_t> loadedByPath;
+    TextureReferences             textureReferences;
+
+    static ModelOptions optionsWithGamma(bool gamma)
+    {
+        ModelOptions options;
+        options.gamma = gamma;
+        return options;
+    }
+
+    // draws every mesh the culler left visible, all of them without one
+    void drawMeshes(Shader &shader, const FrustumCuller *visible)
+    {
+        if(!packed)
+        {
+            for(unsigned int i = 0; i < meshes.size(); i++)
+                if(!visible || visible->visible(i))
+                    meshes[i].Draw(shader);
+            return;
+        }
+
+        // one VAO for the whole model, each mesh only swaps its textures and draws its range
+        glBindVertexArray(arena.vertexArray());
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if(visible && !visible->visible(i))
+                continue;
+            meshes[i].bindTextures(shader);
+            meshes[i].bindQuantization(shader);
+            meshes[i].drawElements();
+        }
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // post processing the model is imported with, part of the mesh cache's key
+    static const unsigned int IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // the imported meshes are cached next to the model, as long as the model doesn't change later loads skip ASSIMP.
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        MeshCache cache(path, IMPORT_FLAGS, lodLevels);
+        if(cache.load())
+        {
+            // upload straight from the mapped file
+            for(const CachedMesh &mesh : cache.meshes())
+            {
+                vector<Texture> textures;
+                for(const Texture &texture : mesh.textures)
+                    textures.push_back(loadTexture(texture.path, texture.type));
+                if(packed)
+                    meshes.emplace_back(vector<Vertex>(), vector<unsigned int>(), std::move(textures), arena.add(mesh.vertices, mesh.vertexCount, mesh.indices, mesh.indexCount));
+                else
+                    meshes.emplace_back(mesh.vertices, mesh.vertexCount, mesh.indices, mesh.indexCount, std::move(textures), format);
+                meshes.back().lods   = mesh.lods;
+                meshes.back().bounds = boundsOf(mesh.vertices, mesh.vertexCount);
+                // the mapping goes with the cache, the CPU side copy has to come out of it now
+                if(keepMeshData)
+                {
+                    meshes.back().vertices.assign(mesh.vertices, mesh.vertices + mesh.vertexCount);
+                    meshes.back().indices.assign(mesh.indices, mesh.indices + mesh.indexCount);
+                }
+            }
+            // the mapping is still open here
+            arena.upload();
+            return;
+        }
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, IMPORT_FLAGS);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<const aiMesh*> sceneMeshes;
+        processNode(scene->mRootNode, scene, sceneMeshes);
+        processMeshes(sceneMeshes, scene);
+        cout << "MESH_OPTIMIZER:: " << path << ": " << optimization.triangles << " triangles, vertices "
+             << optimization.verticesBefore << " -> " << optimization.verticesAfter
+             << ", ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr
+             << ", ATVR " << optimization.before.atvr << " -> " << optimization.after.atvr << endl;
+        if(lodLevels > 1)
+        {
+            // meshes that ran out of levels early count with their coarsest one
+            cout << "MESH_SIMPLIFIER:: " << path << ": triangles per level of detail";
+            for(unsigned int level = 0; level < lodLevels; level++)
+            {
+                size_t triangles = 0;
+                for(const Mesh &mesh : meshes)
+                    triangles += (mesh.lods.empty() ? mesh.indexCount : mesh.lods[std::min<size_t>(level, mesh.lods.size() - 1)].indexCount) / 3;
+                cout << " " << triangles;
+            }
+            cout << endl;
+        }
+
+        // a model that can't be cached still loads, just through ASSIMP again next time
+        cache.store(meshes);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // a mesh converted from ASSIMP's format, everything but the GL objects
+    struct MeshData
     {
-        // process each mesh located at the current node
+        vector<Vertex>       vertices;
+        vector<unsigned int> indices;
+        vector<Texture>      textures;  // type and path only, the texture itself is loaded on the main thread
+        vector<MeshLod>      lods;
+        MeshBounds           bounds;
+        MeshOptimizer::Report optimization;
+    };
+
+    // processes a node in a recursive fashion. Collects each individual mesh located at the node and repeats this process on its children nodes (if any).
+    void processNode(aiNode *node, const aiScene *scene, vector<const aiMesh*> &sceneMeshes)
+    {
+        // collect each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            sceneMeshes.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
-        // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
+        // after we've collected all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, sceneMeshes);
+        }
+
+    }
+
+    // converts the meshes on a thread pool, then creates their textures and buffers here, on the thread owning the context.
+    // meshes keep the order of the node walk.
+    void processMeshes(const vector<const aiMesh*> &sceneMeshes, const aiScene *scene)
+    {
+        vector<MeshData> converted(sceneMeshes.size());
+        if(sceneMeshes.size() > 1)
+        {
+            ThreadPool pool(std::min<unsigned int>((unsigned int)sceneMeshes.size(), std::max(std::thread::hardware_concurrency(), 1u)));
+            vector<std::future<void>> jobs;
+            jobs.reserve(sceneMeshes.size());
+            for(size_t i = 0; i < sceneMeshes.size(); i++)
+                jobs.push_back(pool.submit([&, i] { converted[i] = processMesh(sceneMeshes[i], scene, lodLevels); }));
+            for(std::future<void> &job : jobs)
+                job.get();
         }
+        else if(!sceneMeshes.empty())
+            converted[0] = processMesh(sceneMeshes[0], scene, lodLevels);
+
+        optimization = MeshOptimizer::Report();
+        for(const MeshData &data : converted)
+            optimization += data.optimization;
 
+        meshes.reserve(meshes.size() + converted.size());
+        for(MeshData &data : converted)
+        {
+            for(Texture &texture : data.textures)
+                texture = loadTexture(texture.path, texture.type);
+            if(packed)
+            {
+                // moving the vectors keeps their storage where the arena expects it
+                MeshRange range = arena.add(data.vertices.data(), data.vertices.size(), data.indices.data(), data.indices.size());
+                meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(data.textures), range);
+            }
+            else
+                meshes.emplace_back(std::move(data.vertices), std::move(data.indices), std::move(data.textures), format);
+            meshes.back().lods   = std::move(data.lods);
+            meshes.back().bounds = data.bounds;
+        }
+        arena.upload();
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // only reads the scene, safe to run for several meshes at once
+    static MeshData processMesh(const aiMesh *mesh, const aiScene *scene, unsigned int lodLevels)
     {
         // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
+        MeshData data;
+        vector<Vertex> &vertices = data.vertices;
+        vector<unsigned int> &indices = data.indices;
+        vector<Texture> &textures = data.textures;
 
         // walk through each of the mesh's vertices
+        vertices.resize(mesh->mNumVertices);
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
+            Vertex &vertex = vertices[i];
             glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
             // positions
             vector.x = mesh->mVertices[i].x;
@@ -131,17 +365,27 @@ private:
             }
             else
                 vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // triangulated faces have 3 indices, anything else (points, lines) is counted first so the vector is sized once.
+        size_t indexCount = 0;
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indexCount += mesh->mFaces[i].mNumIndices;
+        indices.resize(indexCount);
+        unsigned int *index = indices.data();
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace &face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);        
+                *index++ = face.mIndices[j];
         }
+        // ready the mesh for the GPU's vertex cache, while still on the worker
+        data.optimization = MeshOptimizer::optimize(vertices, indices);
+        data.bounds = boundsOf(vertices.data(), vertices.size());
+        // coarser levels go behind the full mesh in the same index list, sharing its vertices
+        if(lodLevels > 1)
+            data.lods = MeshSimplifier::buildLods(vertices, indices, lodLevels);
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -152,94 +396,55 @@ private:
         // normal: texture_normalN
 
         // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
+        loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse", textures);
         // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
+        loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular", textures);
         // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
+        loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal", textures);
         // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
+        loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height", textures);
         
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return data;
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // appends all material textures of a given type, the textures get loaded later by loadTexture.
+    static void loadMaterialTextures(const aiMaterial *mat, aiTextureType type, const string &typeName, vector<Texture> &textures)
     {
-        vector<Texture> textures;
         for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            Texture texture;
+            texture.id = 0;
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
         }
-        return textures;
+    }
+
+    // the texture at path (relative to the model). every path is looked up once per model, the registry shares
+    // the texture with other models using the same file
+    Texture loadTexture(const string &path, const string &typeName)
+    {
+        auto found = loadedByPath.find(path);
+        if(found != loadedByPath.end())
+            return textures_loaded[found->second];
+        Texture texture;
+        texture.id = textureReferences.acquire(this->directory + '/' + path);
+        texture.type = typeName;
+        texture.path = path;
+        loadedByPath.emplace(path, textures_loaded.size());
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
     }
 };
 
 
+// loads a texture of its own, outside of the TextureRegistry. the caller deletes it
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
-
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
-    }
-    else
-    {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-    }
-
-    return textureID;
+    return TextureRegistry::loadFromFile(filename);
 }
 #endif
@@ -12,12 +12,14 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_registry.h>
 
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <learnopengl/assimp_glm_helpers.h>
 #include <learnopengl/animdata.h>
@@ -56,6 +58,9 @@ private:
 
 	std::map<string, BoneInfo> m_OffsetMatMap;
 	int m_BoneCount = 0;
+    // textures_loaded by the path the model's materials use, and the model's share of the texture registry
+    unordered_map<string, size_t> loadedByPath;
+    TextureReferences             textureReferences;
 
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
@@ -95,7 +100,7 @@ private:
 
     }
 
-	void SetVertexBoneDataToDefault(Vertex& vertex)
+	void SetVertexBoneDataToDefault(VertexBoneData& vertex)
 	{
 		for (int i = 0; i < MAX_BONE_WEIGHTS; i++)
 		{
@@ -108,13 +113,14 @@ private:
 	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
 	{
 		vector<Vertex> vertices;
+		vector<VertexBoneData> bones(mesh->mNumVertices);
 		vector<unsigned int> indices;
 		vector<Texture> textures;
 
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
 		{
 			Vertex vertex;
-			SetVertexBoneDataToDefault(vertex);
+			SetVertexBoneDataToDefault(bones[i]);
 			vertex.Position = AssimpGLMHelpers::GetGLMVec(mesh->mVertices[i]);
 			vertex.Normal = AssimpGLMHelpers::GetGLMVec(mesh->mNormals[i]);
 			
@@ -147,12 +153,14 @@ private:
 		std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 
-		ExtractBoneWeightForVertices(vertices,mesh,scene);
+		ExtractBoneWeightForVertices(bones,mesh,scene);
 
-		return Mesh(vertices, indices, textures);
+		Mesh result(std::move(vertices), std::move(indices), std::move(textures));
+		result.setBoneData(bones);
+		return result;
 	}
 
-	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
+	void SetVertexBoneData(VertexBoneData& vertex, int boneID, float weight)
 	{
 		for (int i = 0; i < MAX_BONE_WEIGHTS; ++i)
 		{
@@ -166,7 +174,7 @@ private:
 	}
 
 
-	void ExtractBoneWeightForVertices(std::vector<Vertex>& vertices, aiMesh* mesh, const aiScene* scene)
+	void ExtractBoneWeightForVertices(std::vector<VertexBoneData>& vertices, aiMesh* mesh, const aiScene* scene)
 	{
 		auto& boneInfoMap = m_OffsetMatMap;
 		int& boneCount = m_BoneCount;
@@ -203,46 +211,6 @@ private:
 	}
 
 
-	unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false)
-	{
-		string filename = string(path);
-		filename = directory + '/' + filename;
-
-		unsigned int textureID;
-		glGenTextures(1, &textureID);
-
-		int width, height, nrComponents;
-		unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			GLenum format;
-			if (nrComponents == 1)
-				format = GL_RED;
-			else if (nrComponents == 3)
-				format = GL_RGB;
-			else if (nrComponents == 4)
-				format = GL_RGBA;
-
-			glBindTexture(GL_TEXTURE_2D, textureID);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Texture failed to load at path: " << path << std::endl;
-			stbi_image_free(data);
-		}
-
-		return textureID;
-	}
-    
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
     // the required info is returned as a Texture struct.
     vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
@@ -253,25 +221,20 @@ private:
             aiString str;
             mat->GetTexture(type, i, &str);
             // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
+            auto found = loadedByPath.find(str.C_Str());
+            if(found != loadedByPath.end())
             {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+                textures.push_back(textures_loaded[found->second]);
+                continue;
             }
+            // if texture hasn't been loaded by this model, get it from the registry: other models may have loaded it
+            Texture texture;
+            texture.id = textureReferences.acquire(this->directory + '/' + str.C_Str());
+            texture.type = typeName;
+            texture.path = str.C_Str();
+            textures.push_back(texture);
+            loadedByPath.emplace(texture.path, textures_loaded.size());
+            textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
         }
         return textures;
     }
@@ -0,0 +1,192 @@
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <stb_image.h>
+
+#include <learnopengl/texture_streamer.h>
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+using namespace std;
+
+// Process wide table of the textures loaded from files, keyed by their canonical absolute path: "a/../b.png",
+// "./b.png" and the absolute path all end up as the same GL texture, loaded once. every acquire() adds a
+// reference, the texture is deleted when the last one is released. like every GL call, only use it on the thread
+// owning the context.
+//
+// with a TextureStreamer set, new textures load in the background: acquire() returns at once and the texture
+// shows a placeholder until the streamer's update() uploads it.
+class TextureRegistry
+{
+public:
+    static TextureRegistry& instance()
+    {
+        static TextureRegistry registry;
+        return registry;
+    }
+
+    TextureRegistry(const TextureRegistry&) = delete;
+    TextureRegistry& operator=(const TextureRegistry&) = delete;
+
+    // the texture for the file, loaded on first use. a file that fails to load still gets a (blank) texture, the
+    // same as TextureFromFile
+    unsigned int acquire(const string &filename)
+    {
+        const string key = canonicalPath(filename);
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            found->second.references++;
+            return found->second.id;
+        }
+        Entry entry;
+        entry.id = streamer ? streamer->request(filename) : loadFromFile(filename);
+        entry.references = 1;
+        entries.emplace(key, entry);
+        keys.emplace(entry.id, key);
+        return entry.id;
+    }
+
+    // drops one reference taken by acquire(), ids the registry doesn't know are left alone
+    void release(unsigned int id)
+    {
+        auto key = keys.find(id);
+        if (key == keys.end())
+            return;
+        auto entry = entries.find(key->second);
+        if (--entry->second.references == 0)
+        {
+            if (streamer)
+                streamer->cancel(id);
+            glDeleteTextures(1, &id);
+            entries.erase(entry);
+            keys.erase(key);
+        }
+    }
+
+    // textures currently loaded
+    size_t size() const { return entries.size(); }
+
+    // streams the textures acquired from now on, nullptr goes back to loading them right away. unset it before the
+    // streamer is destroyed
+    void setStreamer(TextureStreamer *textureStreamer) { streamer = textureStreamer; }
+    TextureStreamer *textureStreamer() const { return streamer; }
+
+    // references held on a texture, 0 if it isn't loaded
+    unsigned int references(const string &filename) const
+    {
+        auto found = entries.find(canonicalPath(filename));
+        return found == entries.end() ? 0 : found->second.references;
+    }
+
+    // absolute, with . and .. and symbolic links resolved as far as the path exists, forward slashes
+    static string canonicalPath(const string &filename)
+    {
+        std::error_code error;
+        std::filesystem::path path = std::filesystem::absolute(filename, error);
+        if (error)
+            path = filename;
+        std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        return (error ? path.lexically_normal() : canonical).generic_string();
+    }
+
+    // decodes the image and uploads it with mipmaps
+    static unsigned int loadFromFile(const string &filename)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+
+        int width, height, nrComponents;
+        unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
+        if (data)
+        {
+            GLenum format;
+            if (nrComponents == 1)
+                format = GL_RED;
+            else if (nrComponents == 3)
+                format = GL_RGB;
+            else if (nrComponents == 4)
+                format = GL_RGBA;
+
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+            glGenerateMipmap(GL_TEXTURE_2D);
+
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+            stbi_image_free(data);
+        }
+        else
+        {
+            std::cout << "Texture failed to load at path: " << filename << std::endl;
+            stbi_image_free(data);
+        }
+
+        return textureID;
+    }
+
+private:
+    struct Entry
+    {
+        unsigned int id;
+        unsigned int references;
+    };
+
+    unordered_map<string, Entry>        entries;    // canonical path -> texture
+    unordered_map<unsigned int, string> keys;       // texture -> canonical path, for release()
+    TextureStreamer                    *streamer = nullptr;
+
+    TextureRegistry() {}
+};
+
+// the registry references held by one owner (a Model), released when it goes. move only
+class TextureReferences
+{
+public:
+    TextureReferences() {}
+    ~TextureReferences() { clear(); }
+
+    TextureReferences(const TextureReferences&) = delete;
+    TextureReferences& operator=(const TextureReferences&) = delete;
+
+    TextureReferences(TextureReferences &&other) noexcept : ids(std::move(other.ids)) { other.ids.clear(); }
+
+    TextureReferences& operator=(TextureReferences &&other) noexcept
+    {
+        if (this != &other)
+        {
+            clear();
+            ids = std::move(other.ids);
+            other.ids.clear();
+        }
+        return *this;
+    }
+
+    // acquires the file's texture and keeps the reference
+    unsigned int acquire(const string &filename)
+    {
+        unsigned int id = TextureRegistry::instance().acquire(filename);
+        ids.push_back(id);
+        return id;
+    }
+
+    void clear()
+    {
+        for (unsigned int id : ids)
+            TextureRegistry::instance().release(id);
+        ids.clear();
+    }
+
+private:
+    vector<unsigned int> ids;
+};
+#endif
@@ -0,0 +1,269 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <stb_image.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+// Loads textures in the background. request() hands out a texture right away that shows a 1x1 placeholder,
+// decoding runs on a pool of worker threads and update(), called once per frame on the thread owning the
+// context, uploads what is decoded, at most budget bytes of pixels per call. the texture keeps its name when the
+// real image replaces the placeholder, so meshes never have to rebind anything.
+//
+// uploads go through a ring of pixel unpack buffers that stays mapped (GL 4.4 / ARB_buffer_storage), split in
+// SEGMENTS parts of budget bytes each. every update() fills one part and fences it, the part is only written
+// again once the GPU is done reading it. without buffer storage the pixels are uploaded from client memory.
+// an image larger than the budget is uploaded on its own, from client memory, so nothing waits forever.
+//
+// stbi_set_flip_vertically_on_load is process wide, set it before the first request().
+class TextureStreamer
+{
+public:
+    static const size_t DEFAULT_BUDGET = 8 << 20;  // bytes per update()
+    static const unsigned int SEGMENTS = 3;         // updates the GPU may still be reading staged pixels from
+
+    // threads = 0 picks one decoder per hardware thread. needs loadGLExtensions() for the mapped ring
+    explicit TextureStreamer(size_t budget = DEFAULT_BUDGET, unsigned int threads = 0)
+        : budget(std::max<size_t>(budget, 4)), pool(new ThreadPool(threads))
+    {
+        if (!glext().ARB_buffer_storage)
+            return;
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, &ring);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+        glext().BufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)(this->budget * SEGMENTS), NULL, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)(this->budget * SEGMENTS), flags);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (!mapped)
+        {
+            glDeleteBuffers(1, &ring);
+            ring = 0;
+        }
+    }
+
+    // decodes still queued are skipped, textures not uploaded yet keep their placeholder
+    ~TextureStreamer()
+    {
+        stopping = true;
+        // joins the workers before anything they push to goes
+        pool.reset();
+        for (Decoded &image : decoded)
+            stbi_image_free(image.pixels);
+        for (Decoded &image : ready)
+            stbi_image_free(image.pixels);
+        for (GLsync fence : fences)
+            if (fence)
+                glDeleteSync(fence);
+        if (ring)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            glDeleteBuffers(1, &ring);
+        }
+    }
+
+    TextureStreamer(const TextureStreamer&) = delete;
+    TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+    // a new texture showing the placeholder, the file gets decoded in the background
+    unsigned int request(const string &filename)
+    {
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, PLACEHOLDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        // texture names get reused once deleted, the ticket tells a current request from a cancelled one
+        const uint64_t ticket = ++lastTicket;
+        waiting[textureID] = ticket;
+        pool->submit([this, textureID, ticket, filename] {
+            if (stopping)
+                return;
+            Decoded image;
+            image.texture = textureID;
+            image.ticket  = ticket;
+            image.pixels  = stbi_load(filename.c_str(), &image.width, &image.height, &image.components, 0);
+            if (!image.pixels)
+                std::cout << "Texture failed to load at path: " << filename << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_back(image);
+        });
+        return textureID;
+    }
+
+    // forgets the request for a texture that is about to be deleted, its image is thrown away once decoded
+    void cancel(unsigned int textureID)
+    {
+        waiting.erase(textureID);
+    }
+
+    // uploads decoded images until the budget is spent, returns the number of textures that became resident
+    unsigned int update()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready.insert(ready.end(), decoded.begin(), decoded.end());
+            decoded.clear();
+        }
+        lastBytes = 0;
+        if (ready.empty())
+            return 0;
+
+        // the segment filled SEGMENTS updates ago is normally read by now. if it isn't, this update uploads from
+        // client memory rather than wait
+        bool ringFree = ring != 0;
+        if (ringFree && fences[segment])
+        {
+            if (glClientWaitSync(fences[segment], 0, 0) == GL_TIMEOUT_EXPIRED)
+                ringFree = false;
+            else
+            {
+                glDeleteSync(fences[segment]);
+                fences[segment] = 0;
+            }
+        }
+
+        GLint alignment;
+        glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+        // rows of 1 and 3 channel images aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+        unsigned int uploaded = 0;
+        size_t staged = 0;
+        while (!ready.empty())
+        {
+            Decoded &image = ready.front();
+            auto request = waiting.find(image.texture);
+            if (request == waiting.end() || request->second != image.ticket)
+            {
+                stbi_image_free(image.pixels);
+                ready.pop_front();
+                continue;
+            }
+            const size_t bytes = image.pixels ? (size_t)image.width * image.height * image.components : 0;
+            // the first image always goes, whatever its size
+            if (lastBytes > 0 && lastBytes + bytes > budget)
+                break;
+
+            // 4 byte steps through the segment keep every image's start aligned
+            const size_t offset = (staged + 3) & ~(size_t)3;
+            if (image.pixels && ringFree && offset + bytes <= budget)
+            {
+                std::memcpy(mapped + segment * budget + offset, image.pixels, bytes);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring);
+                upload(image, (const void*)(segment * budget + offset));
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                staged = offset + bytes;
+            }
+            else if (image.pixels)
+                upload(image, image.pixels);
+
+            lastBytes += bytes;
+            uploaded++;
+            waiting.erase(request);
+            stbi_image_free(image.pixels);
+            ready.pop_front();
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+
+        if (staged > 0)
+        {
+            fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            segment = (segment + 1) % SEGMENTS;
+        }
+        return uploaded;
+    }
+
+    // updates until every requested texture is resident, for loading screens and tools
+    void finish()
+    {
+        while (!waiting.empty())
+        {
+            if (update() == 0)
+                std::this_thread::yield();
+        }
+    }
+
+    // textures still showing their placeholder
+    size_t pendingCount() const { return waiting.size(); }
+
+    // pixel bytes the last update() uploaded
+    size_t uploadedBytes() const { return lastBytes; }
+
+    // true if uploads go through the mapped ring
+    bool persistentlyMapped() const { return mapped != nullptr; }
+
+private:
+    struct Decoded
+    {
+        unsigned int   texture = 0;
+        uint64_t       ticket = 0;
+        unsigned char *pixels = nullptr;    // from stbi_load, null if decoding failed
+        int width = 0, height = 0, components = 0;
+    };
+
+    // mid grey, reads as "no detail" for colour maps
+    static constexpr unsigned char PLACEHOLDER[4] = { 128, 128, 128, 255 };
+
+    size_t budget;
+    size_t lastBytes = 0;
+
+    // decode results, written by the workers
+    std::mutex      mutex;
+    vector<Decoded> decoded;
+    std::atomic<bool> stopping{ false };
+
+    // owned by the thread with the context
+    deque<Decoded>                          ready;
+    unordered_map<unsigned int, uint64_t>   waiting;    // texture -> ticket of its request
+    uint64_t                                lastTicket = 0;
+
+    GLuint         ring = 0;
+    unsigned char *mapped = nullptr;
+    GLsync         fences[SEGMENTS] = {};
+    unsigned int   segment = 0;
+
+    std::unique_ptr<ThreadPool> pool;
+
+    // pixels is a pointer for client memory or an offset into the bound unpack buffer
+    static void upload(const Decoded &image, const void *pixels)
+    {
+        GLenum format = GL_RGBA;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 2)
+            format = GL_RG;
+        else if (image.components == 3)
+            format = GL_RGB;
+
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+#endif
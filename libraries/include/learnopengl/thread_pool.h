@@ -0,0 +1,87 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// fixed size pool of worker threads pulling from one shared queue. submit() hands back a future for the result.
+// none of the workers owns a GL context, so jobs must stay away from GL calls.
+class ThreadPool
+{
+public:
+    // 0 picks one worker per hardware thread
+    explicit ThreadPool(unsigned int threads = 0)
+    {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads == 0)
+            threads = 1;
+        workers.reserve(threads);
+        for (unsigned int i = 0; i < threads; i++)
+            workers.emplace_back([this] { run(); });
+    }
+
+    // finishes the queued jobs, then joins the workers
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queues a job, the future holds its result (or the exception it threw)
+    template <typename F>
+    std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& job)
+    {
+        typedef std::invoke_result_t<std::decay_t<F>> Result;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push([task] { (*task)(); });
+        }
+        wake.notify_one();
+        return result;
+    }
+
+    unsigned int size() const { return (unsigned int)workers.size(); }
+
+private:
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+
+    std::vector<std::thread>          workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex                        mutex;
+    std::condition_variable           wake;
+    bool                              stopping = false;
+};
+#endif
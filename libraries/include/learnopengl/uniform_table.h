@@ -0,0 +1,172 @@
+#ifndef UNIFORM_TABLE_H
+#define UNIFORM_TABLE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// resolved uniform; look it up once and reuse it in hot loops instead of passing names around.
+// it indexes the shader's uniform table, so it stays valid when the program is rebuilt (hot reload).
+struct UniformHandle
+{
+    GLint index = -1;
+
+    bool valid() const { return index >= 0; }
+};
+
+// flat, open-addressed table of the active uniforms of a linked program.
+// built once after link so set* calls never have to go through glGetUniformLocation.
+class UniformTable
+{
+public:
+    // reflects all active uniforms of the program. names already in the table keep their index
+    // (and get location -1 if the new program lacks them), so handles survive a rebuild.
+    void build(GLuint program)
+    {
+        for (GLint& location : locations)
+            location = -1;
+
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<char> buffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint   size   = 0;
+            GLenum  type   = 0;
+            glGetActiveUniform(program, (GLuint)i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+            std::string name(buffer.data(), length);
+
+            GLint location = glGetUniformLocation(program, name.c_str());
+            // uniforms living in a uniform block have no location
+            if (location < 0)
+                continue;
+
+            // arrays are reported as "name[0]", make "name" and every "name[i]" resolvable as well
+            const std::size_t bracket = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0 ? name.size() - 3 : std::string::npos;
+            if (bracket == std::string::npos)
+            {
+                add(name, location);
+                continue;
+            }
+            std::string base = name.substr(0, bracket);
+            add(base, location);
+            add(name, location);
+            for (GLint element = 1; element < size; element++)
+            {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                add(elementName, glGetUniformLocation(program, elementName.c_str()));
+            }
+        }
+
+        rehash();
+    }
+
+    // returns the location of the uniform or -1 if the program has no such active uniform
+    GLint find(const char* name) const
+    {
+        const GLint entry = lookup(name);
+        return entry >= 0 ? locations[entry] : -1;
+    }
+
+    // handle for the name. names the program doesn't use (yet) get a slot too, so a handle
+    // taken before a reload that adds the uniform starts working after it.
+    UniformHandle handle(const char* name)
+    {
+        UniformHandle h;
+        h.index = lookup(name);
+        if (h.index < 0)
+        {
+            h.index = (GLint)names.size();
+            add(name, -1);
+            rehash();
+        }
+        return h;
+    }
+
+    // location behind a handle, -1 (ignored by glUniform*) for an invalid one
+    GLint location(UniformHandle handle) const
+    {
+        return handle.index >= 0 ? locations[handle.index] : -1;
+    }
+
+    std::size_t size() const { return names.size(); }
+
+    // FNV-1a over the zero terminated name, no allocation
+    static uint32_t hash(const char* name)
+    {
+        uint32_t h = 2166136261u;
+        for (; *name; ++name)
+        {
+            h ^= (unsigned char)*name;
+            h *= 16777619u;
+        }
+        return h;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t hash  = 0;
+        GLint    entry = -1;
+    };
+
+    // index of the entry for the name, or -1
+    GLint lookup(const char* name) const
+    {
+        if (slots.empty())
+            return -1;
+        const uint32_t h = hash(name);
+        const std::size_t mask = slots.size() - 1;
+        for (std::size_t slot = h & mask; slots[slot].entry >= 0; slot = (slot + 1) & mask)
+        {
+            const Slot& s = slots[slot];
+            if (s.hash == h && std::strcmp(names[s.entry].c_str(), name) == 0)
+                return s.entry;
+        }
+        return -1;
+    }
+
+    // sets the location of an entry from before the current build or appends a new one.
+    // the index still covers the old names only, which is all it has to: a program reports each name once.
+    void add(const std::string& name, GLint location)
+    {
+        const GLint entry = lookup(name.c_str());
+        if (entry >= 0)
+        {
+            locations[entry] = location;
+            return;
+        }
+        names.push_back(name);
+        locations.push_back(location);
+    }
+
+    // rebuilds the open-addressed index over names
+    void rehash()
+    {
+        // keep the load factor at or below one half
+        std::size_t capacity = 8;
+        while (capacity < names.size() * 2)
+            capacity *= 2;
+        slots.assign(capacity, Slot());
+        for (std::size_t i = 0; i < names.size(); i++)
+        {
+            const uint32_t h = hash(names[i].c_str());
+            std::size_t slot = h & (capacity - 1);
+            while (slots[slot].entry >= 0)
+                slot = (slot + 1) & (capacity - 1);
+            slots[slot].hash  = h;
+            slots[slot].entry = (GLint)i;
+        }
+    }
+
+    std::vector<std::string> names;
+    std::vector<GLint>       locations;
+    std::vector<Slot>        slots;
+};
+#endif
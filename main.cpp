@@ -1,4 +1,11 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,8 +15,15 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <stb_image.h>
+#include <learnopengl/gl_extensions.h>
 
 #include "Shader.h"
+#include "ShaderLibrary.h"
+#include "ShaderWatcher.h"
+#include "HeadlessContext.h"
+#include "Profiler.h"
+#include "ProgramCache.h"
+#include "UniformBuffer.h"
 
 /*! @brief Resize the window.
  *
@@ -40,69 +54,249 @@ void processInput(GLFWwindow* window)
 		glfwSetWindowShouldClose(window, true);
 }
 
-int main()
+/*! @brief Model matrix of every cube.
+ *
+ *  The first ones come from the hand placed positions, anything past
+ *  that goes on a grid behind them so large counts have somewhere to be.
+ *
+ *  @param[in] hand placed positions.
+ *  @param[in] number of hand placed positions.
+ *  @param[in] number of cubes.
+ */
+std::vector<glm::mat4> cubeTransforms(const glm::vec3* positions, size_t known, size_t count)
 {
-	// Initialize the GLFW
-	glfwInit();
+	std::vector<glm::mat4> transforms(count);
+	const size_t side = (size_t)std::ceil(std::cbrt((double)count));
+	for (size_t i = 0; i < count; i++)
+	{
+		glm::vec3 position = i < known ? positions[i] : glm::vec3(
+			2.f * (float)(i % side) - (float)side,
+			2.f * (float)(i / side % side) - (float)side,
+			-20.f - 2.f * (float)(i / (side * side)));
+		transforms[i] = glm::rotate(glm::translate(glm::mat4(1.f), position),
+			glm::radians(20.f * (float)(i % 18)), glm::vec3(1.f, .3f, .5f));	// 20 degree steps, wraps every 18
+	}
+	return transforms;
+}
 
-	/*! @brief Config the GLFW
-	*	Telling GLFW what version of openGL using
-	*
-	*	@param[in] GLFW_CONTEXT_VERSION_MAJOR { Hint }
-	*   @param[in] 3.3 version of openGL
-	*/
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	// Modern function from core profile
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#ifdef __APPLE__	// For mac OS
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif // __APPLE__
+/*! @brief Point the cube samplers at their texture units.
+ *
+ *  Uniforms live in the program: set them again whenever the watcher
+ *  swaps in a rebuilt one.
+ *
+ *  @param[in] shader sampling texture1 and texture2.
+ */
+void setSamplers(Shader& shader)
+{
+	shader.use();
+	shader.setInt("texture1", 0);
+	shader.setInt("texture2", 1);
+}
 
-	/*! @brief Creating window or console by 800x600.
-	*
-	*	@param[in] WIDTH.
-	*	@param[in] HEIGHT.
-	*	@param[in] Name of window.
-	*	@param[in] Monitor mode Full or not.
-	*	@param[in] Share mode.
-	*/
-	GLFWwindow* window = glfwCreateWindow(
-		800,
-		600,
-		"LearnOpenGL",
-		NULL,
-		NULL
-	);
-	// Checking if window is created successfully or not
-	if (!window)
+/*! @brief Upload the per instance model matrices.
+ *
+ *  Re-specifies the whole buffer so the driver doesn't wait for draws
+ *  still reading the previous contents.
+ *
+ *  @param[in] instance buffer.
+ *  @param[in] model matrices.
+ */
+void uploadInstances(GLuint instanceVBO, const std::vector<glm::mat4>& transforms)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(transforms.size() * sizeof(glm::mat4)),
+		transforms.data(), GL_STREAM_DRAW);
+}
+
+/*! @brief Time the per draw and the instanced cube path.
+ *
+ *  Sweeps the instance count from 10 to 1,000,000. Both paths send every
+ *  matrix each frame, one as a uniform per draw call and the other as one
+ *  buffer upload followed by a single glDrawArraysInstanced, so the
+ *  numbers are what a scene of moving objects would cost. "cpu" is the
+ *  time spent issuing the frame, "frame" also waits for the GPU.
+ *
+ *  @param[in] window pointer, NULL when headless.
+ *  @param[in] per draw shader.
+ *  @param[in] instanced shader.
+ *  @param[in] cube vertex array, with the instance attributes set up.
+ *  @param[in] instance buffer.
+ */
+void runBenchmark(GLFWwindow* window, Shader& perDraw, Shader& instanced, GLuint VAO, GLuint instanceVBO)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	const UniformHandle modelLoc = perDraw.uniform("model");
+
+	// don't let vsync cap the frame rate
+	if (window)
+		glfwSwapInterval(0);
+	glBindVertexArray(VAO);
+
+	std::cout << std::setw(10) << "instances"
+		<< std::setw(16) << "per draw cpu" << std::setw(16) << "per draw frame"
+		<< std::setw(16) << "instanced cpu" << std::setw(16) << "instanced frame" << "  (ms/frame)\n";
+
+	for (size_t count = 10; count <= 1000000; count *= 10)
 	{
-		std::cerr << "[ERROR]Failed to creare GLFW window\n";
-		glfwTerminate();
-		return -1;
+		const std::vector<glm::mat4> transforms = cubeTransforms(nullptr, 0, count);
+		// fewer frames for the big counts, the per draw path gets slow
+		const int frames = (int)std::min<size_t>(100, std::max<size_t>(3, 200000 / count));
+
+		double cpuMs[2] = {}, frameMs[2] = {};
+		for (int path = 0; path < 2; path++)
+		{
+			for (int frame = -2; frame < frames; frame++)	// two warm up frames
+			{
+				Clock::time_point start = Clock::now();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				if (path == 0)
+				{
+					perDraw.use();
+					for (const glm::mat4& transform : transforms)
+					{
+						perDraw.setMat4(modelLoc, transform);
+						glDrawArrays(GL_TRIANGLES, 0, 36);
+					}
+				}
+				else
+				{
+					instanced.use();
+					uploadInstances(instanceVBO, transforms);
+					glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)count);
+				}
+				Clock::time_point issued = Clock::now();
+				if (window)
+					glfwSwapBuffers(window);
+				glFinish();
+				if (window)
+					glfwPollEvents();
+
+				if (frame < 0)
+					continue;
+				cpuMs[path]   += std::chrono::duration<double, std::milli>(issued - start).count();
+				frameMs[path] += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+			}
+		}
+
+		std::cout << std::fixed << std::setprecision(3) << std::setw(10) << count
+			<< std::setw(16) << cpuMs[0] / frames << std::setw(16) << frameMs[0] / frames
+			<< std::setw(16) << cpuMs[1] / frames << std::setw(16) << frameMs[1] / frames << "\n";
 	}
+}
 
-	// Telling the glfw the window in the current context
-	glfwMakeContextCurrent(window);
-	//  tell GLFW we want to call this function on every window resize
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+int main(int argc, char** argv)
+{
+	// --benchmark times both cube paths and exits, --per-draw draws the cubes one by one
+	// --headless renders --frames N frames without a display, --dump writes the last one as a PPM
+	// --trace writes the profiled frames as Chrome trace JSON on exit
+	bool benchmark = false, perDraw = false, headless = false;
+	int frames = 300;
+	const char* dumpPath = NULL;
+	const char* tracePath = NULL;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0)
+			benchmark = true;
+		else if (std::strcmp(argv[i], "--per-draw") == 0)
+			perDraw = true;
+		else if (std::strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			frames = std::max(1, std::atoi(argv[++i]));
+		else if (std::strcmp(argv[i], "--dump") == 0 && i + 1 < argc)
+			dumpPath = argv[++i];
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+			tracePath = argv[++i];
+	}
 
-	/*! @brief Calling GLAD manager function to initialize.
-	*
-	*	This function bind GLAD before calling the OpenGL function.
-	*
-	*	@param[in] Address of OpenGL.
-	*/
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	GLFWwindow* window = NULL;
+	// no display: EGL surfaceless context rendering into an FBO, glad loaded by it
+	std::unique_ptr<HeadlessContext> offscreen;
+	if (headless)
 	{
-		std::cerr << "[ERROR]Failed to initialized GLAD\n";
-		glfwTerminate();
-		return -1;
+		offscreen.reset(new HeadlessContext(800, 600));
+		if (!offscreen->valid())
+			return -1;
+	}
+	else
+	{
+		// Initialize the GLFW
+		glfwInit();
+
+		/*! @brief Config the GLFW
+		*	Telling GLFW what version of openGL using
+		*
+		*	@param[in] GLFW_CONTEXT_VERSION_MAJOR { Hint }
+		*   @param[in] 3.3 version of openGL
+		*/
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		// Modern function from core profile
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__	// For mac OS
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif // __APPLE__
+
+		/*! @brief Creating window or console by 800x600.
+		*
+		*	@param[in] WIDTH.
+		*	@param[in] HEIGHT.
+		*	@param[in] Name of window.
+		*	@param[in] Monitor mode Full or not.
+		*	@param[in] Share mode.
+		*/
+		window = glfwCreateWindow(
+			800,
+			600,
+			"LearnOpenGL",
+			NULL,
+			NULL
+		);
+		// Checking if window is created successfully or not
+		if (!window)
+		{
+			std::cerr << "[ERROR]Failed to creare GLFW window\n";
+			glfwTerminate();
+			return -1;
+		}
+
+		// Telling the glfw the window in the current context
+		glfwMakeContextCurrent(window);
+		//  tell GLFW we want to call this function on every window resize
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+		/*! @brief Calling GLAD manager function to initialize.
+		*
+		*	This function bind GLAD before calling the OpenGL function.
+		*
+		*	@param[in] Address of OpenGL.
+		*/
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		{
+			std::cerr << "[ERROR]Failed to initialized GLAD\n";
+			glfwTerminate();
+			return -1;
+		}
 	}
+	// entry points newer than the 3.3 core glad loader (program binaries, ...)
+	loadGLExtensions(headless ? HeadlessContext::loader() : (GLADloadproc)glfwGetProcAddress);
 
 	// build and compile our shader zprogram
 	// ------------------------------------
-	Shader shader("Shader.vs", "Shader.fs");
+	// every program is queued first and compiled in one batch, statuses are only checked on get()
+	ShaderLibrary shaders;
+	ShaderLibrary::Handle cubeProgram = shaders.add("cube", "Shader.vs", "Shader.fs");
+	// same sources, model matrix from a per instance attribute instead of a uniform
+	ShaderLibrary::Handle instancedProgram = shaders.add("cube instanced", "Shader.vs", "Shader.fs", nullptr, { "INSTANCED" });
+	shaders.compileAll();
+	Shader& shader = shaders.get(cubeProgram);
+	Shader& instancedShader = shaders.get(instancedProgram);
+	ProgramCache::printStats(std::cout);
+
+	// edits to Shader.vs / Shader.fs are picked up while running
+	ShaderWatcher watcher;
+	watcher.watch(shader);
+	watcher.watch(instancedShader);
 
 	/*! @brief Setting viewport of window.
 	*
@@ -224,6 +418,25 @@ int main()
 	// Enabling the vertex array
 	glEnableVertexAttribArray((GLuint)1);
 
+	// 5. per instance model matrices, a mat4 attribute is four vec4 columns
+	GLuint instanceVBO;
+	glGenBuffers(1, &instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(
+			(GLuint)2 + column,						// aModel { layout (location = 2) } to 5
+			(GLint)4,								// one vec4 column
+			GL_FLOAT,
+			GL_FALSE,
+			(GLsizei)sizeof(glm::mat4),				// next instance
+			(void*)(column * sizeof(glm::vec4))		// offset of the column
+		);
+		glEnableVertexAttribArray((GLuint)2 + column);
+		// advance once per instance instead of once per vertex
+		glVertexAttribDivisor((GLuint)2 + column, (GLuint)1);
+	}
+
 	// load and create a texture 
 	// -------------------------
 	GLuint texture1, texture2;
@@ -294,16 +507,21 @@ int main()
 	// model matrix
 	glm::mat4 model = glm::mat4(1.f);
 	// view matrix
-	glm::mat4 view = glm::translate(glm::mat4(1.f),
-		glm::vec3(.0f, .0f, -3.f));
+	glm::vec3 cameraPosition(.0f, .0f, 3.f);
+	glm::mat4 view = glm::translate(glm::mat4(1.f), -cameraPosition);
 	// perspective projection matrix
 	glm::mat4 projection = glm::perspective(glm::radians(45.f),
 		800.f / 600.f, .1f, 100.f);
 
 	// manualy assign value
-	shader.use();
-	glUniform1i(glGetUniformLocation(shader.ID, "texture1"), 0);
-	shader.setInt("texture2", 1); // or with shader class
+	setSamplers(shader);
+	setSamplers(instancedShader);
+
+	// resolve the per draw uniforms once, the render loop only uses the handles
+	UniformHandle modelLoc = shader.uniform("model");
+
+	// view and projection live in the Camera block (camera.glsl), uploaded once per frame for every program
+	CameraBuffer cameraBuffer(UniformBlocks::CAMERA);
 
 	// Enabling wireframe mode
 	glPolygonMode(
@@ -328,91 +546,164 @@ int main()
 		glm::vec3(-1.3f,  1.0f, - 1.5f)
 	};
 
+	// the cubes don't move, their matrices go up once
+	const size_t cubeCount = sizeof(cubePosition) / sizeof(cubePosition[0]);
+	uploadInstances(instanceVBO, cubeTransforms(cubePosition, cubeCount, cubeCount));
+
+	if (benchmark)
+	{
+		cameraBuffer.update(CameraData::from(view, projection, cameraPosition));
+		runBenchmark(window, shader, instancedShader, VAO, instanceVBO);
+		if (window)
+			glfwTerminate();
+		return 0;
+	}
+
+	// headless runs a fixed number of frames and times each of them
+	std::vector<double> frameTimes;
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// CPU and GPU time of every part of the frame, statistics over the last 120 frames
+	Profiler profiler;
+
 	// Forcing winow to open
-	while (!glfwWindowShouldClose(window))
+	for (int frame = 0; headless ? frame < frames : !glfwWindowShouldClose(window); frame++)
 	{
+		auto frameStart = std::chrono::high_resolution_clock::now();
+		profiler.beginFrame();
+
+		{
+			// swap in shaders rebuilt since the last frame, a new program has lost the sampler units
+			Profiler::Scope zone(profiler, "shader reload", false);
+			std::vector<Shader*> reloaded;
+			watcher.poll(&reloaded);
+			for (Shader* reloadedShader : reloaded)
+				setSamplers(*reloadedShader);
+		}
+
 		// input
-		processInput(window);
-
-		// render
-		// clear the colorbuffer
-		// Specifying the background color of window in rgba
-		glClearColor((GLfloat)0.2f, (GLfloat)0.3f, (GLfloat)0.3f, (GLfloat)1.0f);
-		// Clean the background color and setting new color
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// bind Texture
-		glActiveTexture(GL_TEXTURE0); // activate texture unit first
-		glBindTexture(GL_TEXTURE_2D, texture1);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, texture2);
-
-		// Activate the shader
-		shader.use();
-
-		// rotate container over time
-		model = glm::rotate(model,
-			(float)glfwGetTime(),
-			glm::vec3(.5f, 1.0f, .0f));
-
-		// setting uniform container object
-		glUniformMatrix4fv(
-			glGetUniformLocation(shader.ID, (const GLchar*)"model"),
-			(GLsizei)1,								// # of matrix
-			GL_FALSE,								// want to tanspose of matrix
-			(const GLfloat*)glm::value_ptr(model)	// actual matrix
-		);
-		glUniformMatrix4fv(
-			glGetUniformLocation(shader.ID, (const GLchar*)"view"),
-			(GLsizei)1,								// # of matrix
-			GL_FALSE,								// want to tanspose of matrix
-			(const GLfloat*)glm::value_ptr(view)	// actual matrix
-		);
-		glUniformMatrix4fv(
-			glGetUniformLocation(shader.ID, (const GLchar*)"projection"),
-			(GLsizei)1,								// # of matrix
-			GL_FALSE,								// want to tanspose of matrix
-			(const GLfloat*)glm::value_ptr(projection)	// actual matrix
-		);
+		if (window)
+		{
+			Profiler::Scope zone(profiler, "input", false);
+			processInput(window);
+		}
+
+		{
+			// render
+			// clear the colorbuffer
+			Profiler::Scope zone(profiler, "clear");
+			// Specifying the background color of window in rgba
+			glClearColor((GLfloat)0.2f, (GLfloat)0.3f, (GLfloat)0.3f, (GLfloat)1.0f);
+			// Clean the background color and setting new color
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		{
+			// bind Texture
+			Profiler::Scope zone(profiler, "bind textures");
+			glActiveTexture(GL_TEXTURE0); // activate texture unit first
+			glBindTexture(GL_TEXTURE_2D, texture1);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, texture2);
+		}
+
+		{
+			// one upload per frame, however many programs read it
+			Profiler::Scope zone(profiler, "camera upload");
+			cameraBuffer.update(CameraData::from(view, projection, cameraPosition));
+		}
 
-		// 4. draw the object
-		glBindVertexArray(VAO);
+		{
+			// 4. draw the object
+			Profiler::Scope zone(profiler, "draw");
+			glBindVertexArray(VAO);
+
+			if (perDraw)
+			{
+				// Activate the shader
+				shader.use();
+
+				// rotate container over time
+				model = glm::rotate(model,
+					(float)std::chrono::duration<double>(frameStart - startTime).count(),
+					glm::vec3(.5f, 1.0f, .0f));
+
+				// setting uniform container object
+				shader.setMat4(modelLoc, model);
+
+				// Drawing the triangle
+				for (unsigned int i = 0; i < 10; i++)
+				{
+					shader.setMat4(
+						modelLoc,
+						glm::rotate(
+							glm::translate(
+								glm::mat4(1.f),
+								cubePosition[i]
+							),
+							glm::radians(20.f * i),
+							glm::vec3(1.f, .3f, .5f)
+						)
+					);
+					glDrawArrays(GL_TRIANGLES, 0, 36);
+				}
+			}
+			else
+			{
+				// every cube in one draw call, the matrices are already in the instance buffer
+				instancedShader.use();
+				glDrawArraysInstanced(GL_TRIANGLES, 0, 36, (GLsizei)cubeCount);
+			}
+		}
 
-		// Drawing the triangle
-		for (unsigned int i = 0; i < 10; i++)
+		if (headless)
 		{
-			shader.setMat4(
-				"model",
-				glm::rotate(
-					glm::translate(
-						glm::mat4(1.f),
-						cubePosition[i]
-					),
-					glm::radians(20.f * i),
-					glm::vec3(1.f, .3f, .5f)
-				)
-			);
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+			// nothing to present, wait for the GPU so the time covers the whole frame
+			Profiler::Scope zone(profiler, "finish", false);
+			glFinish();
 		}
+		else
+		{
+			Profiler::Scope zone(profiler, "present", false);
+			// Swap the backg buffer with front buffer
+			glfwSwapBuffers(window);
+
+			// rendering the window 
+			// Taking care of all events
+			// Check and call events and swap the buffer
+			glfwPollEvents();
+		}
+
+		profiler.endFrame();
+		frameTimes.push_back(std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - frameStart).count());
+	}
 
-		// Swap the backg buffer with front buffer
-		glfwSwapBuffers(window);
+	profiler.flush();
+	profiler.printStats(std::cout);
+	if (tracePath)
+		profiler.writeTrace(tracePath);
 
-		// rendering the window 
-		// Taking care of all events
-		// Check and call events and swap the buffer
-		glfwPollEvents();
+	if (headless)
+	{
+		HeadlessContext::Percentiles times = HeadlessContext::percentiles(frameTimes);
+		std::cout << std::fixed << std::setprecision(3) << "[HEADLESS] " << frameTimes.size() << " frames, "
+			<< "p50: " << times.p50 << " ms, p95: " << times.p95 << " ms, p99: " << times.p99 << " ms\n";
+		if (dumpPath && !offscreen->writePPM(dumpPath))
+			return -1;
 	}
 
 	// optional: de-allocate all resources once they've outlived their purpose:
 	// ------------------------------------------------------------------------
 	glDeleteVertexArrays(1, &VAO);
 	glDeleteBuffers(1, &VBO);
+	glDeleteBuffers(1, &instanceVBO);
 	glDeleteTextures(1, &texture1);
 	glDeleteTextures(2, &texture2);
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
-	glfwTerminate();
+	if (window)
+		glfwTerminate();
 	return 0;
 }
@@ -0,0 +1,45 @@
+// attributes of a VERTEX_PACKED mesh (PackedVertex in learnopengl/mesh.h) and their decoding
+// keep in sync with setupVertexAttributes
+layout (location = 0) in vec4 aPackedPosition;	// quantized position, w = bitangent sign
+layout (location = 1) in vec2 aPackedNormal;	// octahedral
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in vec2 aPackedTangent;	// octahedral
+
+// per mesh, set by Mesh::bindQuantization. IndirectRenderer passes them per draw instead, its shaders use
+// drawPosition(quantizedPosition()) from indirect.glsl. either way the model matrix stays the object transform,
+// so normal matrices derived from it are right for the decoded normals and tangents
+uniform vec3 positionScale;
+uniform vec3 positionOffset;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+vec3 quantizedPosition()
+{
+	return aPackedPosition.xyz;
+}
+
+vec3 decodePosition()
+{
+	return aPackedPosition.xyz * positionScale + positionOffset;
+}
+
+vec3 decodeNormal()
+{
+	return octDecode(aPackedNormal);
+}
+
+vec3 decodeTangent()
+{
+	return octDecode(aPackedTangent);
+}
+
+vec3 decodeBitangent()
+{
+	return cross(decodeNormal(), decodeTangent()) * aPackedPosition.w;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/animation_system.h>
+
+// characters in the crowd and bones in each one's skeleton, all playing the same clip at their own phase
+const unsigned int CHARACTERS = 2000;
+const unsigned int BONES = 64;
+// bones per limb: a limb hangs off the root and each bone off the one before it
+const unsigned int LIMB = 8;
+// keys per track, one per tick
+const unsigned int KEYS = 60;
+const int TICKS_PER_SECOND = 30;
+// frames timed per thread count, at 60 fps
+const unsigned int FRAMES = 120;
+const float FRAME_TIME = 1.0f / 60.0f;
+
+/*! @brief Builds a looping clip animating every bone of a BONES bone skeleton, no file or GPU needed.
+ *
+ *  @return animation owning its hierarchy, tracks and bone ids.
+ */
+Animation* makeAnimation()
+{
+	NodeHierarchy hierarchy;
+	std::vector<Bone> bones;
+	std::map<std::string, BoneInfo> boneInfoMap;
+	bones.reserve(BONES);
+	for (unsigned int i = 0; i < BONES; i++)
+	{
+		std::string name = "bone" + std::to_string(i);
+		hierarchy.transforms.push_back(glm::mat4(1.0f));
+		hierarchy.parents.push_back(i == 0 ? -1 : (i % LIMB == 1 ? 0 : (int)i - 1));
+		hierarchy.nameHashes.push_back(NodeHierarchy::HashName(name));
+		boneInfoMap[name] = { (int)i, glm::mat4(1.0f) };
+
+		aiNodeAnim channel;
+		channel.mNumPositionKeys = channel.mNumRotationKeys = channel.mNumScalingKeys = KEYS;
+		channel.mPositionKeys = new aiVectorKey[KEYS];
+		channel.mRotationKeys = new aiQuatKey[KEYS];
+		channel.mScalingKeys = new aiVectorKey[KEYS];
+		for (unsigned int key = 0; key < KEYS; key++)
+		{
+			float t = (float)key;
+			float phase = t * 0.1f + (float)i;
+			channel.mPositionKeys[key] = aiVectorKey(t, aiVector3D(0.0f, 0.1f, 0.0f));
+			channel.mRotationKeys[key] = aiQuatKey(t, aiQuaternion(aiVector3D(1.0f, 0.0f, 0.0f), 0.3f * std::sin(phase)));
+			channel.mScalingKeys[key] = aiVectorKey(t, aiVector3D(1.0f, 1.0f, 1.0f));
+		}
+		bones.push_back(Bone(name, (int)i, &channel));
+	}
+	return new Animation(hierarchy, bones, boneInfoMap, (float)(KEYS - 1), TICKS_PER_SECOND);
+}
+
+/*! @brief Time FRAMES updates of the whole crowd.
+ *
+ *  @param[in] animation clip every character plays.
+ *  @param[in] threads threads updating the crowd, the caller included.
+ *  @param[out] checksum sum over the last palette, the same for every thread count.
+ *  @return ms per frame.
+ */
+double timeCrowd(Animation* animation, unsigned int threads, double& checksum)
+{
+	AnimationSystem system(threads);
+	system.Reserve(CHARACTERS, CHARACTERS * (size_t)BONES * 2);
+	for (unsigned int i = 0; i < CHARACTERS; i++)
+	{
+		size_t character = system.Add(animation);
+		// spread the crowd over the clip
+		system.GetAnimator(character).UpdateAnimation((KEYS - 1.0f) / TICKS_PER_SECOND * i / CHARACTERS);
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int frame = 0; frame < FRAMES; frame++)
+		system.Update(FRAME_TIME);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	checksum = 0.0;
+	for (const glm::mat4& matrix : system.GetPalettes())
+		checksum += matrix[3][0] + matrix[3][1] + matrix[3][2];
+	return std::chrono::duration<double, std::milli>(end - start).count() / FRAMES;
+}
+
+/*! @brief Times the crowd on 1, 2, 4... threads up to the hardware's, or up to argv[1] threads.
+ */
+int main(int argc, char** argv)
+{
+	Animation* animation = makeAnimation();
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	if (argc > 1)
+		cores = (unsigned int)std::atoi(argv[1]);
+	if (cores == 0)
+		cores = 1;
+	std::cout << CHARACTERS << " characters x " << BONES << " bones, up to " << cores << " threads\n";
+	std::cout << std::setw(8) << "threads" << std::setw(16) << "ms per frame" << std::setw(12) << "speedup"
+		<< std::setw(20) << "checksum" << "\n";
+
+	double single = 0.0;
+	for (unsigned int threads = 1; ; threads = std::min(threads * 2, cores))
+	{
+		double checksum = 0.0;
+		double ms = timeCrowd(animation, threads, checksum);
+		if (threads == 1)
+			single = ms;
+		std::cout << std::setw(8) << threads << std::setw(16) << std::fixed << std::setprecision(3) << ms
+			<< std::setw(12) << std::setprecision(2) << single / ms
+			<< std::setw(20) << std::setprecision(6) << checksum << "\n";
+		if (threads == cores)
+			break;
+	}
+
+	delete animation;
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/bone.h>
+
+// bones per skeleton and skeletons sampled per frame, each playing the clip at its own phase
+const unsigned int BONES = 64;
+const unsigned int SKELETONS = 16;
+// frames timed per clip length, at 60 fps
+const unsigned int FRAMES = 240;
+const float FRAME_TIME = 1.0f / 60.0f;
+// one key per tick on every track
+const float TICKS_PER_SECOND = 30.0f;
+
+/*! @brief Builds an animation channel with one key per tick.
+ *
+ *  @param[in] keys number of keys in each of the three tracks.
+ *  @param[in] seed varies the motion between bones.
+ *  @return channel owning its key arrays.
+ */
+aiNodeAnim* makeChannel(unsigned int keys, unsigned int seed)
+{
+	aiNodeAnim* channel = new aiNodeAnim();
+	channel->mNumPositionKeys = channel->mNumRotationKeys = channel->mNumScalingKeys = keys;
+	channel->mPositionKeys = new aiVectorKey[keys];
+	channel->mRotationKeys = new aiQuatKey[keys];
+	channel->mScalingKeys = new aiVectorKey[keys];
+	for (unsigned int i = 0; i < keys; i++)
+	{
+		float t = (float)i;
+		float phase = t * 0.1f + (float)seed;
+		channel->mPositionKeys[i] = aiVectorKey(t, aiVector3D(std::sin(phase), std::cos(phase), 0.0f));
+		channel->mRotationKeys[i] = aiQuatKey(t, aiQuaternion(aiVector3D(0.0f, 1.0f, 0.0f), phase));
+		channel->mScalingKeys[i] = aiVectorKey(t, aiVector3D(1.0f, 1.0f, 1.0f));
+	}
+	return channel;
+}
+
+/*! @brief The keys of one bone, copied out of its channel the way Bone stores them.
+ */
+struct Track
+{
+	std::vector<KeyPosition> positions;
+	std::vector<KeyRotation> rotations;
+	std::vector<KeyScale> scales;
+};
+
+/*! @brief Copies a channel's keys into a Track.
+ *
+ *  @param[in] channel keys to copy.
+ *  @return track with the channel's keys.
+ */
+Track makeTrack(const aiNodeAnim* channel)
+{
+	Track track;
+	for (unsigned int i = 0; i < channel->mNumPositionKeys; i++)
+		track.positions.push_back({ AssimpGLMHelpers::GetGLMVec(channel->mPositionKeys[i].mValue), (float)channel->mPositionKeys[i].mTime });
+	for (unsigned int i = 0; i < channel->mNumRotationKeys; i++)
+		track.rotations.push_back({ AssimpGLMHelpers::GetGLMQuat(channel->mRotationKeys[i].mValue), (float)channel->mRotationKeys[i].mTime });
+	for (unsigned int i = 0; i < channel->mNumScalingKeys; i++)
+		track.scales.push_back({ AssimpGLMHelpers::GetGLMVec(channel->mScalingKeys[i].mValue), (float)channel->mScalingKeys[i].mTime });
+	return track;
+}
+
+/*! @brief Key lookup the way Bone did it before cursors: a scan from key 0.
+ *
+ *  @param[in] keys one track, at least two keys.
+ *  @param[in] animationTime time to look up.
+ *  @return index of the key starting the segment.
+ */
+template <typename Key>
+int linearIndex(const std::vector<Key>& keys, float animationTime)
+{
+	for (int index = 0; index < (int)keys.size() - 1; ++index)
+	{
+		if (animationTime < keys[index + 1].timeStamp)
+			return index;
+	}
+	return (int)keys.size() - 2;
+}
+
+/*! @brief How far animationTime is between two keys, the same as Bone's.
+ */
+float scaleFactor(float lastTimeStamp, float nextTimeStamp, float animationTime)
+{
+	float framesDiff = nextTimeStamp - lastTimeStamp;
+	if (framesDiff <= 0.0f)
+		return animationTime < lastTimeStamp ? 0.0f : 1.0f;
+	return glm::clamp((animationTime - lastTimeStamp) / framesDiff, 0.0f, 1.0f);
+}
+
+/*! @brief Bone::Sample with the linear key lookup: the same interpolation and matrices,
+ *  only the keys are found differently.
+ *
+ *  @param[in] track keys of the bone.
+ *  @param[in] animationTime time to sample.
+ *  @return the bone's local transform.
+ */
+glm::mat4 linearSample(const Track& track, float animationTime)
+{
+	int p = linearIndex(track.positions, animationTime);
+	glm::vec3 position = glm::mix(track.positions[p].position, track.positions[p + 1].position,
+		scaleFactor(track.positions[p].timeStamp, track.positions[p + 1].timeStamp, animationTime));
+
+	int r = linearIndex(track.rotations, animationTime);
+	glm::quat rotation = glm::normalize(glm::slerp(track.rotations[r].orientation, track.rotations[r + 1].orientation,
+		scaleFactor(track.rotations[r].timeStamp, track.rotations[r + 1].timeStamp, animationTime)));
+
+	int s = linearIndex(track.scales, animationTime);
+	glm::vec3 scale = glm::mix(track.scales[s].scale, track.scales[s + 1].scale,
+		scaleFactor(track.scales[s].timeStamp, track.scales[s + 1].timeStamp, animationTime));
+
+	return glm::translate(glm::mat4(1.0f), position) * glm::toMat4(rotation) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+/*! @brief Time FRAMES frames of sampling every bone of every skeleton.
+ *
+ *  @param[in] duration clip length in ticks.
+ *  @param[in] sample called with (skeleton, bone, time), returns a value to keep the work alive.
+ *  @return ns per frame.
+ */
+template <typename Sample>
+double timeFrames(float duration, Sample sample)
+{
+	float sink = 0.0f;
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int frame = 0; frame < FRAMES; frame++)
+	{
+		for (unsigned int skeleton = 0; skeleton < SKELETONS; skeleton++)
+		{
+			float time = std::fmod(frame * FRAME_TIME * TICKS_PER_SECOND + duration * skeleton / SKELETONS, duration);
+			for (unsigned int bone = 0; bone < BONES; bone++)
+				sink += sample(skeleton, bone, time);
+		}
+	}
+	auto end = std::chrono::high_resolution_clock::now();
+	// never true, stops the compiler from dropping the samples
+	if (sink == 12345.678f)
+		std::cout << "";
+	return std::chrono::duration<double, std::nano>(end - start).count() / FRAMES;
+}
+
+int main()
+{
+	std::cout << SKELETONS << " skeletons x " << BONES << " bones, ns per frame\n";
+	std::cout << std::setw(8) << "keys" << std::setw(16) << "linear scan" << std::setw(16) << "binary search"
+		<< std::setw(16) << "cursor" << "\n";
+
+	for (unsigned int keys : { 10u, 100u, 1000u, 10000u })
+	{
+		std::vector<Bone> bones;
+		std::vector<Track> tracks;
+		bones.reserve(BONES);
+		tracks.reserve(BONES);
+		for (unsigned int i = 0; i < BONES; i++)
+		{
+			aiNodeAnim* channel = makeChannel(keys, i);
+			bones.push_back(Bone("bone" + std::to_string(i), (int)i, channel));
+			tracks.push_back(makeTrack(channel));
+			delete channel;
+		}
+		const float duration = (float)(keys - 1);
+
+		// 1. a full sample the way Update used to do it: every lookup scans from key 0
+		double linear = timeFrames(duration, [&](unsigned int, unsigned int bone, float time)
+			{
+				return linearSample(tracks[bone], time)[3][0];
+			});
+
+		// 2. a full sample without any history: every lookup is a binary search
+		double search = timeFrames(duration, [&](unsigned int, unsigned int bone, float time)
+			{
+				BoneCursor cursor;
+				return bones[bone].Sample(time, cursor)[3][0];
+			});
+
+		// 3. a full sample resuming from each skeleton's cursors
+		std::vector<BoneCursor> cursors(SKELETONS * BONES);
+		double cursor = timeFrames(duration, [&](unsigned int skeleton, unsigned int bone, float time)
+			{
+				return bones[bone].Sample(time, cursors[skeleton * BONES + bone])[3][0];
+			});
+
+		std::cout << std::setw(8) << keys << std::setw(16) << (long long)linear << std::setw(16) << (long long)search
+			<< std::setw(16) << (long long)cursor << "\n";
+	}
+	return 0;
+}
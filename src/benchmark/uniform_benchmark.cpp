@@ -0,0 +1,108 @@
+#include <iostream>
+#include <chrono>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Shader.h"
+
+// number of draws timed per variant
+const unsigned int DRAWS = 200000;
+
+/*! @brief Time DRAWS model uploads + draw calls.
+ *
+ *  Flushes the queue before and after so the numbers are
+ *  the CPU submission cost of the variant and nothing else.
+ *
+ *  @param[in] label printed in front of the result.
+ *  @param[in] upload sets the model matrix for draw i.
+ *  @param[in] baseline ns/draw of the reference variant, 0 for none.
+ *  @return ns per draw.
+ */
+template <typename Upload>
+double timeDraws(const char* label, Upload upload, double baseline)
+{
+	glFinish();
+	auto start = std::chrono::high_resolution_clock::now();
+	for (unsigned int i = 0; i < DRAWS; i++)
+	{
+		upload(glm::translate(glm::mat4(1.f), glm::vec3((float)(i & 15), .0f, .0f)));
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFinish();
+	auto end = std::chrono::high_resolution_clock::now();
+
+	double ns = std::chrono::duration<double, std::nano>(end - start).count() / DRAWS;
+	std::cout << label << ns << " ns/draw";
+	if (baseline > 0.0)
+		std::cout << "  (" << baseline / ns << "x)";
+	std::cout << "\n";
+	return ns;
+}
+
+int main()
+{
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// nothing is presented, keep the window out of the way
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+#ifdef __APPLE__	// For mac OS
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif // __APPLE__
+
+	GLFWwindow* window = glfwCreateWindow(64, 64, "uniform benchmark", NULL, NULL);
+	if (!window)
+	{
+		std::cerr << "[ERROR]Failed to creare GLFW window\n";
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	// no vsync, nothing here waits on the display
+	glfwSwapInterval(0);
+
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cerr << "[ERROR]Failed to initialized GLAD\n";
+		glfwTerminate();
+		return -1;
+	}
+
+	Shader shader("Shader.vs", "Shader.fs");
+	shader.use();
+
+	// core profile needs a VAO bound, the attributes are left disabled
+	GLuint VAO;
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	std::cout << DRAWS << " draws, model matrix upload per draw\n";
+
+	// 1. what the render loop used to do: query the location by name each draw
+	double lookup = timeDraws("glGetUniformLocation + upload : ", [&](const glm::mat4& model)
+		{
+			glUniformMatrix4fv(glGetUniformLocation(shader.ID, "model"), 1, GL_FALSE, &model[0][0]);
+		}, 0.0);
+
+	// 2. name based setter, hashed into the reflected uniform table
+	timeDraws("cached name lookup + upload   : ", [&](const glm::mat4& model)
+		{
+			shader.setMat4("model", model);
+		}, lookup);
+
+	// 3. handle resolved once up front
+	UniformHandle modelLoc = shader.uniform("model");
+	timeDraws("uniform handle + upload       : ", [&](const glm::mat4& model)
+		{
+			shader.setMat4(modelLoc, model);
+		}, lookup);
+
+	glDeleteVertexArrays(1, &VAO);
+	glfwTerminate();
+	return 0;
+}